@@ -3,6 +3,8 @@
 #include "GeometryCollection/GeometryCollection.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "ThumbnailRequest.h"
+#include "Materials/MaterialInstanceDynamic.h"
 
 
 ARenderActor::ARenderActor()
@@ -44,6 +46,62 @@ ECameraProjectionMode::Type ARenderActor::GetProjection()
 {
 	return Capturer->ProjectionType;
 }
+void ARenderActor::ApplyQualityProfile(EThumbnailQualityProfile profile)
+{
+	QualityProfile = profile;
+
+	// The component turns some game show flags off in its constructor, a fresh ESFIM_Game set would bring them back.
+	if (!DefaultShowFlags.IsSet())
+	{
+		DefaultShowFlags = Capturer->ShowFlags;
+		DefaultPostProcessSettings = Capturer->PostProcessSettings;
+		DefaultPostProcessBlendWeight = Capturer->PostProcessBlendWeight;
+	}
+	Capturer->ShowFlags = DefaultShowFlags.GetValue();
+	Capturer->PostProcessSettings = DefaultPostProcessSettings;
+	Capturer->PostProcessBlendWeight = DefaultPostProcessBlendWeight;
+	Capturer->CaptureSource = ESceneCaptureSource::SCS_FinalColorHDR;
+
+	switch (profile)
+	{
+	case EThumbnailQualityProfile::Fast:
+	{
+		// Unlit, with post processing and every history based or screen space effect off so a single capture is already
+		// final. Stays on the final color source, scene color sources store inverse opacity in alpha and would flip coverage.
+		FEngineShowFlags& flags = Capturer->ShowFlags;
+		flags.SetLighting(false);
+		flags.SetPostProcessing(false);
+		flags.SetAtmosphere(false);
+		flags.SetFog(false);
+		flags.SetVolumetricFog(false);
+		flags.SetSkyLighting(false);
+		flags.SetDynamicShadows(false);
+		flags.SetAmbientOcclusion(false);
+		flags.SetDistanceFieldAO(false);
+		flags.SetScreenSpaceReflections(false);
+		flags.SetReflectionEnvironment(false);
+		flags.SetLumenGlobalIllumination(false);
+		flags.SetLumenReflections(false);
+		flags.SetAntiAliasing(false);
+		flags.SetTemporalAA(false);
+		flags.SetMotionBlur(false);
+		flags.SetBloom(false);
+		flags.SetEyeAdaptation(false);
+		break;
+	}
+	case EThumbnailQualityProfile::Standard:
+		break;
+	case EThumbnailQualityProfile::High:
+	{
+		// The preview camera never moves between settle captures, any motion blur would only be reprojection noise.
+		FPostProcessSettings& settings = Capturer->PostProcessSettings;
+		settings.bOverride_MotionBlurAmount = true;
+		settings.MotionBlurAmount = 0.f;
+		Capturer->PostProcessBlendWeight = 1.f;
+		break;
+	}
+	}
+}
 // Called when the game starts or when spawned
 void ARenderActor::BeginPlay()
 {
@@ -92,6 +150,9 @@ void AThumbnailPreviewMeshActor::SetStaticMesh(UStaticMesh* mesh)
 	{
 		return;
 	}
+	// Overrides first, they still need the part components to reset them.
+	ClearMaterialOverrides();
+	ClearParts();
 	if (!GeometryCollectionName.IsNone())
 	{
 		GeometryCollectionComponent->SetRestCollection(nullptr);
@@ -115,6 +176,8 @@ void AThumbnailPreviewMeshActor::SetSkeletalMesh(USkeletalMesh* mesh)
 	{
 		return;
 	}
+	ClearMaterialOverrides();
+	ClearParts();
 	
 	if (!GeometryCollectionName.IsNone())
 	{
@@ -136,6 +199,8 @@ void AThumbnailPreviewMeshActor::SetSkeletalMesh(USkeletalMesh* mesh)
 }
 void AThumbnailPreviewMeshActor::SetGeometryCollection(UGeometryCollection* collection)
 {
+	ClearMaterialOverrides();
+	ClearParts();
 	if (SkeletalMeshAsset)
 	{
 		SkeletalMesh->SetSkeletalMesh(nullptr);
@@ -153,8 +218,224 @@ void AThumbnailPreviewMeshActor::SetGeometryCollection(UGeometryCollection* coll
 	GeometryCollectionComponent->SetRelativeLocation(-(bounds.Origin));
 	
 }
+void AThumbnailPreviewMeshActor::SetParts(const TArray<FThumbnailPart>& parts, uint32 partsHash)
+{
+	if (!GeometryCollectionName.IsNone())
+	{
+		GeometryCollectionComponent->SetRestCollection(nullptr);
+		GeometryCollectionName = NAME_None;
+	}
+	if (SkeletalMeshAsset)
+	{
+		SkeletalMesh->SetSkeletalMesh(nullptr);
+		SkeletalMeshAsset = nullptr;
+	}
+	if (MeshAsset)
+	{
+		Mesh->SetStaticMesh(nullptr);
+		MeshAsset = nullptr;
+	}
+	ClearMaterialOverrides();
+	ClearParts();
+	MeshOffset->SetWorldRotation(FRotator::ZeroRotator);
+
+	TArray<UMeshComponent*, TInlineAllocator<8>> components;
+	int32 numStatic = 0;
+	int32 numSkeletal = 0;
+	for (int32 i = 0; i < parts.Num(); i++)
+	{
+		const FThumbnailPart& part = parts[i];
+		// Parents must come first, anything else is placed at the origin.
+		UMeshComponent* parent = part.Parent >= 0 && part.Parent < i ? components[part.Parent] : nullptr;
+		UMeshComponent* component = nullptr;
+		if (part.SkeletalMesh)
+		{
+			USkeletalMeshComponent* skeletal = AcquirePartComponent(PartSkeletalMeshes, numSkeletal++);
+			skeletal->SetSkeletalMesh(part.SkeletalMesh);
+			if (part.bUseLeaderPose)
+			{
+				skeletal->SetLeaderPoseComponent(Cast<USkeletalMeshComponent>(parent));
+			}
+			component = skeletal;
+		}
+		else if (part.StaticMesh)
+		{
+			UStaticMeshComponent* staticMesh = AcquirePartComponent(PartStaticMeshes, numStatic++);
+			staticMesh->SetStaticMesh(part.StaticMesh);
+			component = staticMesh;
+		}
+		components.Add(component);
+		ActivePartComponents.Add(component);
+		if (!component)
+		{
+			continue;
+		}
+		const FName socket = part.bUseLeaderPose ? NAME_None : part.Socket;
+		component->AttachToComponent(parent ? (USceneComponent*)parent : MeshOffset, FAttachmentTransformRules::KeepRelativeTransform, socket);
+		component->SetRelativeTransform(part.RelativeTransform);
+		component->SetVisibility(true);
+	}
+
+	FBox bounds(ForceInit);
+	for (UMeshComponent* component : components)
+	{
+		if (component)
+		{
+			component->UpdateBounds();
+			bounds += component->Bounds.GetBox();
+		}
+	}
+	// Moving the root parts carries their attachments along, so the whole composite ends up centred like a single mesh.
+	const FVector center = bounds.IsValid ? MeshOffset->GetComponentTransform().InverseTransformPosition(bounds.GetCenter()) : FVector::ZeroVector;
+	for (int32 i = 0; i < components.Num(); i++)
+	{
+		if (components[i] && components[i]->GetAttachParent() == MeshOffset)
+		{
+			components[i]->SetRelativeLocation(parts[i].RelativeTransform.GetLocation() - center);
+		}
+	}
+	PartsRadius = bounds.IsValid ? bounds.GetExtent().Size() : 0;
+	PartsHash = partsHash;
+}
+void AThumbnailPreviewMeshActor::ClearParts()
+{
+	if (PartsHash == 0)
+	{
+		return;
+	}
+	for (USkeletalMeshComponent* component : PartSkeletalMeshes)
+	{
+		component->SetLeaderPoseComponent(nullptr);
+		component->SetSkeletalMesh(nullptr);
+		component->AttachToComponent(MeshOffset, FAttachmentTransformRules::KeepRelativeTransform);
+		component->SetVisibility(false);
+	}
+	for (UStaticMeshComponent* component : PartStaticMeshes)
+	{
+		component->SetStaticMesh(nullptr);
+		component->AttachToComponent(MeshOffset, FAttachmentTransformRules::KeepRelativeTransform);
+		component->SetVisibility(false);
+	}
+	ActivePartComponents.Empty();
+	PartsHash = 0;
+	PartsRadius = 0;
+}
+void AThumbnailPreviewMeshActor::SetMaterialOverrides(const TArray<FThumbnailMaterialOverride>& overrides, uint32 overridesHash)
+{
+	ClearMaterialOverrides();
+
+	TArray<bool, TInlineAllocator<16>> usedInstances;
+	usedInstances.Init(false, MaterialInstances.Num());
+	for (const FThumbnailMaterialOverride& materialOverride : overrides)
+	{
+		UMeshComponent* component = GetOverrideTarget(materialOverride.Part);
+		if (!component)
+		{
+			continue;
+		}
+		const int32 slot = materialOverride.SlotName.IsNone() ? materialOverride.Slot : component->GetMaterialIndex(materialOverride.SlotName);
+		if (slot < 0 || slot >= component->GetNumMaterials())
+		{
+			continue;
+		}
+		UMaterialInterface* material = materialOverride.Material ? materialOverride.Material.Get() : component->GetMaterial(slot);
+		if (materialOverride.ScalarParameters.IsEmpty() && materialOverride.VectorParameters.IsEmpty())
+		{
+			component->SetMaterial(slot, material);
+			continue;
+		}
+		if (!material)
+		{
+			continue;
+		}
+		int32 instanceIndex = INDEX_NONE;
+		for (int32 i = 0; i < MaterialInstances.Num(); i++)
+		{
+			if (!usedInstances[i] && MaterialInstances[i]->Parent == material)
+			{
+				instanceIndex = i;
+				break;
+			}
+		}
+		if (instanceIndex == INDEX_NONE)
+		{
+			instanceIndex = MaterialInstances.Add(UMaterialInstanceDynamic::Create(material, this));
+			usedInstances.Add(false);
+		}
+		usedInstances[instanceIndex] = true;
+
+		UMaterialInstanceDynamic* instance = MaterialInstances[instanceIndex];
+		instance->ClearParameterValues();
+		for (const TPair<FName, float>& parameter : materialOverride.ScalarParameters)
+		{
+			instance->SetScalarParameterValue(parameter.Key, parameter.Value);
+		}
+		for (const TPair<FName, FLinearColor>& parameter : materialOverride.VectorParameters)
+		{
+			instance->SetVectorParameterValue(parameter.Key, parameter.Value);
+		}
+		component->SetMaterial(slot, instance);
+	}
+	MaterialOverridesHash = overridesHash;
+}
+void AThumbnailPreviewMeshActor::ClearMaterialOverrides()
+{
+	if (MaterialOverridesHash == 0)
+	{
+		return;
+	}
+	Mesh->EmptyOverrideMaterials();
+	SkeletalMesh->EmptyOverrideMaterials();
+	GeometryCollectionComponent->EmptyOverrideMaterials();
+	for (UMeshComponent* component : ActivePartComponents)
+	{
+		if (component)
+		{
+			component->EmptyOverrideMaterials();
+		}
+	}
+	MaterialOverridesHash = 0;
+}
+UMeshComponent* AThumbnailPreviewMeshActor::GetOverrideTarget(int32 part) const
+{
+	if (PartsHash != 0)
+	{
+		return ActivePartComponents.IsValidIndex(part) ? ActivePartComponents[part] : nullptr;
+	}
+	if (MeshAsset)
+	{
+		return Mesh;
+	}
+	if (SkeletalMeshAsset)
+	{
+		return SkeletalMesh;
+	}
+	if (!GeometryCollectionName.IsNone())
+	{
+		return GeometryCollectionComponent;
+	}
+	return nullptr;
+}
+template <typename T>
+T* AThumbnailPreviewMeshActor::AcquirePartComponent(TArray<TObjectPtr<T>>& components, int32 index)
+{
+	if (components.IsValidIndex(index))
+	{
+		return components[index];
+	}
+	T* component = NewObject<T>(this);
+	component->SetupAttachment(MeshOffset);
+	component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	component->RegisterComponent();
+	components.Add(component);
+	return component;
+}
 double AThumbnailPreviewMeshActor::GetMeshRadius()
 {
+	if (PartsHash != 0)
+	{
+		return PartsRadius;
+	}
 	if (MeshAsset)
 	{
 		return MeshAsset->GetBounds().SphereRadius;
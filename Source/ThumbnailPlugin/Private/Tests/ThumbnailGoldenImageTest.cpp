@@ -0,0 +1,548 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ThumbnailPlugin.h"
+#include "ThumbnailEngineSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+#include "Algo/Find.h"
+#include "ContentStreaming.h"
+#include "DynamicRHI.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#if WITH_EDITOR
+#include "ShaderCompiler.h"
+#endif
+
+static TAutoConsoleVariable<bool> CVarThumbnailGoldenUpdate(
+	TEXT("Thumbnail.Golden.Update"),
+	false,
+	TEXT("Overwrite the golden images with what ThumbnailPlugin.GoldenImage renders instead of comparing against them. Without it a missing golden fails its case."));
+
+static TAutoConsoleVariable<int32> CVarThumbnailGoldenChannelTolerance(
+	TEXT("Thumbnail.Golden.ChannelTolerance"),
+	8,
+	TEXT("Difference out of 255 a color channel may have from the golden image before the pixel counts as mismatched."));
+
+static TAutoConsoleVariable<float> CVarThumbnailGoldenMaxMismatchPercent(
+	TEXT("Thumbnail.Golden.MaxMismatchPercent"),
+	0.5f,
+	TEXT("Share of mismatched pixels in percent a golden image test tolerates, for anti aliasing and temporal noise along edges."));
+
+namespace ThumbnailGolden
+{
+	enum class EVariant : uint8
+	{
+		Plain,
+		MaterialOverride,
+		PostProcess,
+		Composite
+	};
+
+	struct FCase
+	{
+		const TCHAR* Name;
+		const TCHAR* Mesh;
+		EThumbnailQualityProfile Quality;
+		EVariant Variant;
+		int32 SizeX;
+		int32 SizeY;
+	};
+
+	// Engine content only, so the suite runs in any project. Keep names stable, they are the golden file names.
+	const FCase Cases[] = {
+		{ TEXT("Cube.Fast"), TEXT("/Engine/BasicShapes/Cube.Cube"), EThumbnailQualityProfile::Fast, EVariant::Plain, 128, 128 },
+		{ TEXT("Cube.Standard"), TEXT("/Engine/BasicShapes/Cube.Cube"), EThumbnailQualityProfile::Standard, EVariant::Plain, 128, 128 },
+		{ TEXT("Cube.High"), TEXT("/Engine/BasicShapes/Cube.Cube"), EThumbnailQualityProfile::High, EVariant::Plain, 128, 128 },
+		{ TEXT("Sphere.Standard"), TEXT("/Engine/BasicShapes/Sphere.Sphere"), EThumbnailQualityProfile::Standard, EVariant::Plain, 128, 128 },
+		{ TEXT("Cylinder.Standard"), TEXT("/Engine/BasicShapes/Cylinder.Cylinder"), EThumbnailQualityProfile::Standard, EVariant::Plain, 128, 128 },
+		{ TEXT("Cylinder.Wide"), TEXT("/Engine/BasicShapes/Cylinder.Cylinder"), EThumbnailQualityProfile::Standard, EVariant::Plain, 256, 128 },
+		{ TEXT("Cone.Standard"), TEXT("/Engine/BasicShapes/Cone.Cone"), EThumbnailQualityProfile::Standard, EVariant::Plain, 128, 128 },
+		{ TEXT("Plane.Standard"), TEXT("/Engine/BasicShapes/Plane.Plane"), EThumbnailQualityProfile::Standard, EVariant::Plain, 128, 128 },
+		{ TEXT("Cube.MaterialOverride"), TEXT("/Engine/BasicShapes/Cube.Cube"), EThumbnailQualityProfile::Standard, EVariant::MaterialOverride, 128, 128 },
+		{ TEXT("Cone.PostProcess"), TEXT("/Engine/BasicShapes/Cone.Cone"), EThumbnailQualityProfile::Fast, EVariant::PostProcess, 128, 128 },
+		{ TEXT("Composite.Standard"), TEXT("/Engine/BasicShapes/Cube.Cube"), EThumbnailQualityProfile::Standard, EVariant::Composite, 128, 128 }
+	};
+
+	// Renders differ slightly between RHIs and platforms, each combination keeps its own goldens.
+	FString GetConfigurationName()
+	{
+		return FString::Printf(TEXT("%s_%s"), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()), GDynamicRHI ? GDynamicRHI->GetName() : TEXT("NoRHI"));
+	}
+
+	FString GetGoldenDir()
+	{
+		TSharedPtr<IPlugin> plugin = IPluginManager::Get().FindPlugin(TEXT("ThumbnailPlugin"));
+		const FString baseDir = plugin.IsValid() ? plugin->GetBaseDir() : FPaths::ProjectDir();
+		return FPaths::Combine(baseDir, TEXT("Tests"), TEXT("Golden"), GetConfigurationName());
+	}
+
+	// A configuration counts as recorded once any golden for it is checked in, from then on every case needs its own.
+	bool HasGoldens()
+	{
+		TArray<FString> files;
+		IFileManager::Get().FindFiles(files, *FPaths::Combine(GetGoldenDir(), TEXT("*.png")), true, false);
+		return files.Num() > 0;
+	}
+
+	FString GetOutputDir()
+	{
+		return FPaths::Combine(FPaths::AutomationDir(), TEXT("ThumbnailGolden"), GetConfigurationName());
+	}
+
+	IImageWrapperModule& GetImageWrapperModule()
+	{
+		return FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	}
+
+	bool LoadPNG(const FString& path, int32& outSizeX, int32& outSizeY, TArray64<uint8>& outBGRA)
+	{
+		TArray64<uint8> file;
+		if (!FFileHelper::LoadFileToArray(file, *path, FILEREAD_Silent))
+		{
+			return false;
+		}
+		TSharedPtr<IImageWrapper> imageWrapper = GetImageWrapperModule().CreateImageWrapper(EImageFormat::PNG);
+		if (!imageWrapper.IsValid() || !imageWrapper->SetCompressed(file.GetData(), file.Num()) || !imageWrapper->GetRaw(ERGBFormat::BGRA, 8, outBGRA))
+		{
+			return false;
+		}
+		outSizeX = imageWrapper->GetWidth();
+		outSizeY = imageWrapper->GetHeight();
+		return true;
+	}
+
+	bool SavePNG(const FString& path, int32 sizeX, int32 sizeY, const TArray64<uint8>& bgra)
+	{
+		TSharedPtr<IImageWrapper> imageWrapper = GetImageWrapperModule().CreateImageWrapper(EImageFormat::PNG);
+		if (!imageWrapper.IsValid() || !imageWrapper->SetRaw(bgra.GetData(), bgra.Num(), sizeX, sizeY, ERGBFormat::BGRA, 8))
+		{
+			return false;
+		}
+		IFileManager::Get().MakeDirectory(*FPaths::GetPath(path), true);
+		return FFileHelper::SaveArrayToFile(imageWrapper->GetCompressed(), *path);
+	}
+
+	struct FComparison
+	{
+		int64 Mismatched = 0;
+		int32 MaxDifference = 0;
+		double MeanDifference = 0.0;
+		// Per pixel largest channel difference, amplified so small drifts are visible.
+		TArray64<uint8> Diff;
+	};
+
+	FComparison Compare(const TArray64<uint8>& actual, const TArray64<uint8>& golden, int32 tolerance)
+	{
+		FComparison result;
+		const int64 numPixels = actual.Num() / 4;
+		result.Diff.SetNumZeroed(actual.Num());
+		int64 totalDifference = 0;
+		for (int64 i = 0; i < numPixels; i++)
+		{
+			int32 difference = 0;
+			for (int32 channel = 0; channel < 4; channel++)
+			{
+				difference = FMath::Max(difference, FMath::Abs((int32)actual[i * 4 + channel] - (int32)golden[i * 4 + channel]));
+			}
+			totalDifference += difference;
+			result.MaxDifference = FMath::Max(result.MaxDifference, difference);
+			if (difference > tolerance)
+			{
+				result.Mismatched++;
+			}
+			// Red on opaque black in BGRA order.
+			result.Diff[i * 4 + 2] = (uint8)FMath::Min(difference * 8, 255);
+			result.Diff[i * 4 + 3] = 255;
+		}
+		result.MeanDifference = numPixels > 0 ? (double)totalDifference / numPixels : 0.0;
+		return result;
+	}
+
+	// One case in flight. The pixels arrive on the game thread through a weak pointer, so an aborted test is harmless.
+	struct FRun : public TSharedFromThis<FRun, ESPMode::ThreadSafe>
+	{
+		FAutomationTestBase* Test = nullptr;
+		const FCase* Case = nullptr;
+		bool bQueued = false;
+		bool bDone = false;
+		double WaitStartTime = 0.0;
+		double StartTime = 0.0;
+		double EndTime = 0.0;
+		uint64 StartFrame = 0;
+		uint64 EndFrame = 0;
+		int32 StartCaptures = 0;
+		int32 EndCaptures = 0;
+		int32 SizeX = 0;
+		int32 SizeY = 0;
+		TArray64<uint8> Pixels;
+	};
+
+	// Shaders and streamed mips still compiling or loading would be rendered as fallbacks and differ from run to run.
+	void WaitForContent()
+	{
+#if WITH_EDITOR
+		if (GShaderCompilingManager)
+		{
+			GShaderCompilingManager->FinishAllCompilation();
+		}
+#endif
+		IStreamingManager::Get().StreamAllResources(0.f);
+	}
+
+	bool Queue(FRun& run, UThumbnailEngineSubsystem* service)
+	{
+		const FCase& testCase = *run.Case;
+		UStaticMesh* mesh = LoadObject<UStaticMesh>(nullptr, testCase.Mesh);
+		if (!mesh)
+		{
+			run.Test->AddError(FString::Printf(TEXT("Could not load %s."), testCase.Mesh));
+			return false;
+		}
+
+		FThumbnailRequest* entry = nullptr;
+		if (testCase.Variant == EVariant::Composite)
+		{
+			UStaticMesh* sphere = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Sphere.Sphere"));
+			TArray<FThumbnailPart> parts;
+			parts.AddDefaulted_GetRef().StaticMesh = mesh;
+			FThumbnailPart& top = parts.AddDefaulted_GetRef();
+			top.StaticMesh = sphere;
+			top.Parent = 0;
+			top.RelativeTransform = FTransform(FVector(0.0, 0.0, 100.0));
+			entry = service->QueueMeshThumbnail(parts);
+		}
+		else
+		{
+			entry = service->QueueMeshThumbnail(mesh);
+		}
+		if (!entry)
+		{
+			run.Test->AddError(TEXT("The thumbnail subsystem did not accept the request."));
+			return false;
+		}
+
+		entry->SizeX = testCase.SizeX;
+		entry->SizeY = testCase.SizeY;
+		entry->QualityProfile = testCase.Quality;
+		// The live sky rig, not whatever default preset the project sets.
+		entry->LightingPreset = nullptr;
+		entry->OutputMode = EThumbnailOutputMode::Pixels;
+		entry->CallbackThread = EThumbnailCallbackThread::GameThread;
+		entry->PixelRequest.Format = EThumbnailPixelFormat::BGRA8;
+		entry->PixelRequest.bSRGB = true;
+		if (testCase.Variant == EVariant::MaterialOverride)
+		{
+			FThumbnailMaterialOverride& materialOverride = entry->MaterialOverrides.AddDefaulted_GetRef();
+			materialOverride.Material = LoadObject<UMaterialInterface>(nullptr, TEXT("/Engine/BasicShapes/BasicShapeMaterial.BasicShapeMaterial"));
+			materialOverride.VectorParameters.Add(TEXT("Color"), FLinearColor(0.8f, 0.1f, 0.05f));
+		}
+		else if (testCase.Variant == EVariant::PostProcess)
+		{
+			entry->PostProcess.bFillBackground = true;
+			entry->PostProcess.BackgroundColor = FLinearColor(0.1f, 0.2f, 0.3f);
+			entry->PostProcess.OutlineWidth = 2;
+			entry->PostProcess.OutlineColor = FLinearColor::White;
+			entry->PostProcess.bDropShadow = true;
+		}
+
+		TWeakPtr<FRun, ESPMode::ThreadSafe> weakRun = run.AsShared();
+		entry->OnPixelsComplete.BindLambda([weakRun](const FThumbnailPixels& pixels)
+		{
+			TSharedPtr<FRun, ESPMode::ThreadSafe> pinned = weakRun.Pin();
+			if (!pinned)
+			{
+				return;
+			}
+			pinned->EndTime = FPlatformTime::Seconds();
+			pinned->EndFrame = GFrameCounter;
+			if (pixels.bSuccess)
+			{
+				pinned->SizeX = pixels.SizeX;
+				pinned->SizeY = pixels.SizeY;
+				pinned->Pixels = TArray64<uint8>(pixels.Pixels.GetData(), pixels.Pixels.Num());
+			}
+			pinned->bDone = true;
+		});
+
+		run.StartTime = FPlatformTime::Seconds();
+		run.StartFrame = GFrameCounter;
+		run.StartCaptures = service->GetNumCaptures();
+		return true;
+	}
+
+	void Report(FRun& run, UThumbnailEngineSubsystem* service)
+	{
+		FAutomationTestBase& test = *run.Test;
+		const FCase& testCase = *run.Case;
+		run.EndCaptures = service->GetNumCaptures();
+
+		// Render cost, including preview world creation since every case starts from an idle pipeline.
+		const double milliseconds = (run.EndTime - run.StartTime) * 1000.0;
+		const int32 frames = (int32)(run.EndFrame - run.StartFrame);
+		const int32 captures = run.EndCaptures - run.StartCaptures;
+		test.AddInfo(FString::Printf(TEXT("%s rendered in %.2f ms, %d game frames, %d captures."), testCase.Name, milliseconds, frames, captures));
+		test.AddTelemetryData(TEXT("RenderMs"), milliseconds, testCase.Name);
+		test.AddTelemetryData(TEXT("GameFrames"), frames, testCase.Name);
+		test.AddTelemetryData(TEXT("Captures"), captures, testCase.Name);
+		UE_LOG(LogThumbnail, Display, TEXT("Golden %s: %.2f ms, %d frames, %d captures."), testCase.Name, milliseconds, frames, captures);
+
+		if (!test.TestTrue(TEXT("Pixels delivered"), run.Pixels.Num() > 0))
+		{
+			return;
+		}
+
+		const FString goldenPath = FPaths::Combine(GetGoldenDir(), FString(testCase.Name) + TEXT(".png"));
+		int32 goldenX = 0;
+		int32 goldenY = 0;
+		TArray64<uint8> golden;
+		if (CVarThumbnailGoldenUpdate.GetValueOnGameThread())
+		{
+			if (test.TestTrue(TEXT("Golden image written"), SavePNG(goldenPath, run.SizeX, run.SizeY, run.Pixels)))
+			{
+				test.AddWarning(FString::Printf(TEXT("%s golden image recorded, check it in: %s"), testCase.Name, *goldenPath));
+			}
+			return;
+		}
+		if (!LoadPNG(goldenPath, goldenX, goldenY, golden))
+		{
+			// A run that records its own reference would pass whatever it rendered.
+			const FString actualPath = FPaths::Combine(GetOutputDir(), FString(testCase.Name) + TEXT(".png"));
+			SavePNG(actualPath, run.SizeX, run.SizeY, run.Pixels);
+			test.AddError(FString::Printf(TEXT("%s has no golden image at %s. Review %s and record goldens for %s with Thumbnail.Golden.Update 1."),
+				testCase.Name, *goldenPath, *actualPath, *GetConfigurationName()));
+			return;
+		}
+
+		if (!test.TestTrue(FString::Printf(TEXT("%s is %dx%d like its golden image"), testCase.Name, goldenX, goldenY), run.SizeX == goldenX && run.SizeY == goldenY))
+		{
+			SavePNG(FPaths::Combine(GetOutputDir(), FString(testCase.Name) + TEXT(".png")), run.SizeX, run.SizeY, run.Pixels);
+			return;
+		}
+
+		const FComparison comparison = Compare(run.Pixels, golden, CVarThumbnailGoldenChannelTolerance.GetValueOnGameThread());
+		const double mismatchPercent = 100.0 * comparison.Mismatched / FMath::Max<int64>((int64)run.SizeX * run.SizeY, 1);
+		test.AddInfo(FString::Printf(TEXT("%s differs from its golden image in %.3f%% of pixels, max channel difference %d, mean %.3f."),
+			testCase.Name, mismatchPercent, comparison.MaxDifference, comparison.MeanDifference));
+		if (!test.TestTrue(FString::Printf(TEXT("%s matches its golden image within Thumbnail.Golden tolerances"), testCase.Name),
+			mismatchPercent <= CVarThumbnailGoldenMaxMismatchPercent.GetValueOnGameThread()))
+		{
+			const FString outputDir = GetOutputDir();
+			SavePNG(FPaths::Combine(outputDir, FString(testCase.Name) + TEXT(".png")), run.SizeX, run.SizeY, run.Pixels);
+			SavePNG(FPaths::Combine(outputDir, FString(testCase.Name) + TEXT(".diff.png")), run.SizeX, run.SizeY, comparison.Diff);
+			test.AddInfo(FString::Printf(TEXT("Actual and diff images written to %s"), *outputDir));
+		}
+	}
+}
+
+// Waits for the pipeline to go idle so every case renders from a freshly created preview world, then renders and compares.
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FThumbnailGoldenCommand, TSharedRef<ThumbnailGolden::FRun, ESPMode::ThreadSafe>, Run);
+bool FThumbnailGoldenCommand::Update()
+{
+	using namespace ThumbnailGolden;
+	constexpr double TimeoutSeconds = 120.0;
+	FRun& run = *Run;
+	UThumbnailEngineSubsystem* service = GEngine ? GEngine->GetEngineSubsystem<UThumbnailEngineSubsystem>() : nullptr;
+	if (!service)
+	{
+		run.Test->AddError(TEXT("The thumbnail engine subsystem went away during the test."));
+		return true;
+	}
+	if (FPlatformTime::Seconds() - run.WaitStartTime > TimeoutSeconds)
+	{
+		run.Test->AddError(FString::Printf(TEXT("%s did not finish within %.0f seconds."), run.Case->Name, TimeoutSeconds));
+		return true;
+	}
+
+	if (!run.bQueued)
+	{
+		if (!service->IsIdle())
+		{
+			return false;
+		}
+		service->TrimUnreferencedThumbnails();
+		WaitForContent();
+		run.bQueued = true;
+		return !Queue(run, service);
+	}
+	if (!run.bDone)
+	{
+		return false;
+	}
+	Report(run, service);
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FThumbnailGoldenImageTest, "ThumbnailPlugin.GoldenImage",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+void FThumbnailGoldenImageTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const ThumbnailGolden::FCase& testCase : ThumbnailGolden::Cases)
+	{
+		OutBeautifiedNames.Add(testCase.Name);
+		OutTestCommands.Add(testCase.Name);
+	}
+}
+
+bool FThumbnailGoldenImageTest::RunTest(const FString& Parameters)
+{
+	using namespace ThumbnailGolden;
+	if (!FApp::CanEverRender())
+	{
+		AddWarning(TEXT("Golden image tests render thumbnails and need an RHI, run them with -RenderOffscreen instead of -NullRHI."));
+		return true;
+	}
+	const FCase* testCase = nullptr;
+	for (const FCase& candidate : Cases)
+	{
+		if (Parameters == candidate.Name)
+		{
+			testCase = &candidate;
+		}
+	}
+	if (!TestNotNull(TEXT("Golden image case"), testCase))
+	{
+		return false;
+	}
+	if (!CVarThumbnailGoldenUpdate.GetValueOnGameThread() && !HasGoldens())
+	{
+		AddWarning(FString::Printf(TEXT("No goldens recorded for %s in %s, skipping %s. Record them with Thumbnail.Golden.Update 1 and check them in."),
+			*GetConfigurationName(), *GetGoldenDir(), testCase->Name));
+		return true;
+	}
+
+	TSharedRef<FRun, ESPMode::ThreadSafe> run = MakeShared<FRun, ESPMode::ThreadSafe>();
+	run->Test = this;
+	run->Case = testCase;
+	run->WaitStartTime = FPlatformTime::Seconds();
+	ADD_LATENT_AUTOMATION_COMMAND(FThumbnailGoldenCommand(run));
+	return true;
+}
+
+namespace ThumbnailGolden
+{
+	// Two profiles of one mesh rendered back to back, each from an idle pipeline.
+	struct FAlphaRuns
+	{
+		FAutomationTestBase* Test = nullptr;
+		TArray<TSharedRef<FRun, ESPMode::ThreadSafe>> Runs;
+		int32 Current = 0;
+		double WaitStartTime = 0.0;
+	};
+
+	// Share of pixels whose coverage, alpha above or below one half, differs between the two images.
+	double GetCoverageMismatch(const FRun& a, const FRun& b)
+	{
+		const int64 numPixels = a.Pixels.Num() / 4;
+		int64 mismatched = 0;
+		for (int64 i = 0; i < numPixels; i++)
+		{
+			mismatched += (a.Pixels[i * 4 + 3] >= 128) != (b.Pixels[i * 4 + 3] >= 128) ? 1 : 0;
+		}
+		return numPixels > 0 ? (double)mismatched / numPixels : 1.0;
+	}
+}
+
+// Renders the cube with Fast and Standard and checks both cover the same pixels, with the mesh opaque and the background clear.
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FThumbnailAlphaCommand, TSharedRef<ThumbnailGolden::FAlphaRuns, ESPMode::ThreadSafe>, Runs);
+bool FThumbnailAlphaCommand::Update()
+{
+	using namespace ThumbnailGolden;
+	constexpr double TimeoutSeconds = 120.0;
+	FAlphaRuns& runs = *Runs;
+	UThumbnailEngineSubsystem* service = GEngine ? GEngine->GetEngineSubsystem<UThumbnailEngineSubsystem>() : nullptr;
+	if (!service)
+	{
+		runs.Test->AddError(TEXT("The thumbnail engine subsystem went away during the test."));
+		return true;
+	}
+	if (FPlatformTime::Seconds() - runs.WaitStartTime > TimeoutSeconds)
+	{
+		runs.Test->AddError(FString::Printf(TEXT("Profiles did not finish within %.0f seconds."), TimeoutSeconds));
+		return true;
+	}
+
+	if (runs.Current < runs.Runs.Num())
+	{
+		FRun& run = *runs.Runs[runs.Current];
+		if (!run.bQueued)
+		{
+			if (!service->IsIdle())
+			{
+				return false;
+			}
+			service->TrimUnreferencedThumbnails();
+			WaitForContent();
+			run.bQueued = true;
+			return !Queue(run, service);
+		}
+		if (run.bDone)
+		{
+			runs.Current++;
+		}
+		return false;
+	}
+
+	FAutomationTestBase& test = *runs.Test;
+	const FRun& fast = *runs.Runs[0];
+	const FRun& standard = *runs.Runs[1];
+	if (!test.TestTrue(TEXT("Both profiles delivered pixels of the same size"), fast.Pixels.Num() > 0 && fast.SizeX == standard.SizeX && fast.SizeY == standard.SizeY
+		&& fast.Pixels.Num() == standard.Pixels.Num()))
+	{
+		return true;
+	}
+	for (const FRun* run : { &fast, &standard })
+	{
+		const uint8 centerAlpha = run->Pixels[((int64)(run->SizeY / 2) * run->SizeX + run->SizeX / 2) * 4 + 3];
+		const uint8 cornerAlpha = run->Pixels[3];
+		test.TestTrue(FString::Printf(TEXT("%s mesh is opaque"), run->Case->Name), centerAlpha >= 128);
+		test.TestTrue(FString::Printf(TEXT("%s background is transparent"), run->Case->Name), cornerAlpha < 128);
+	}
+	const double mismatch = GetCoverageMismatch(fast, standard);
+	test.AddInfo(FString::Printf(TEXT("Fast and Standard coverage differs in %.3f%% of pixels."), mismatch * 100.0));
+	// Edges are anti aliased by Standard only.
+	test.TestTrue(TEXT("Fast covers the same pixels as Standard"), mismatch * 100.0 <= 5.0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FThumbnailQualityAlphaTest, "ThumbnailPlugin.QualityProfileAlpha",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FThumbnailQualityAlphaTest::RunTest(const FString& Parameters)
+{
+	using namespace ThumbnailGolden;
+	if (!FApp::CanEverRender())
+	{
+		AddWarning(TEXT("The alpha test renders thumbnails and needs an RHI, run it with -RenderOffscreen instead of -NullRHI."));
+		return true;
+	}
+
+	TSharedRef<FAlphaRuns, ESPMode::ThreadSafe> runs = MakeShared<FAlphaRuns, ESPMode::ThreadSafe>();
+	runs->Test = this;
+	runs->WaitStartTime = FPlatformTime::Seconds();
+	for (const TCHAR* name : { TEXT("Cube.Fast"), TEXT("Cube.Standard") })
+	{
+		const FCase* testCase = Algo::FindByPredicate(Cases, [name](const FCase& candidate) { return FCString::Strcmp(candidate.Name, name) == 0; });
+		if (!TestNotNull(FString::Printf(TEXT("Case %s"), name), testCase))
+		{
+			return false;
+		}
+		TSharedRef<FRun, ESPMode::ThreadSafe> run = MakeShared<FRun, ESPMode::ThreadSafe>();
+		run->Test = this;
+		run->Case = testCase;
+		runs->Runs.Add(run);
+	}
+	ADD_LATENT_AUTOMATION_COMMAND(FThumbnailAlphaCommand(runs));
+	return true;
+}
+
+#endif
@@ -0,0 +1,493 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ThumbnailPlugin.h"
+#include "ThumbnailEngineSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Materials/MaterialInterface.h"
+#include "DynamicRHI.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/App.h"
+#include "Tasks/Task.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectIterator.h"
+#include <atomic>
+
+static TAutoConsoleVariable<float> CVarThumbnailSoakMinutes(
+	TEXT("Thumbnail.Soak.Minutes"),
+	10.f,
+	TEXT("How long ThumbnailPlugin.Soak.PreviewWorldLifetime runs. Set to a few hundred for overnight soaks."));
+
+static TAutoConsoleVariable<int32> CVarThumbnailSoakSeed(
+	TEXT("Thumbnail.Soak.Seed"),
+	0,
+	TEXT("Seed of the randomized request patterns. 0 picks one from the clock, the seed used is logged so a failure can be replayed."));
+
+static TAutoConsoleVariable<int32> CVarThumbnailSoakMaxObjectGrowth(
+	TEXT("Thumbnail.Soak.MaxObjectGrowth"),
+	256,
+	TEXT("UObjects the soak test tolerates gaining over its run once every thumbnail has been released and trimmed."));
+
+static TAutoConsoleVariable<int32> CVarThumbnailSoakMaxTextureGrowth(
+	TEXT("Thumbnail.Soak.MaxTextureGrowth"),
+	4,
+	TEXT("Texture and render target objects the soak test tolerates gaining over its run."));
+
+static TAutoConsoleVariable<float> CVarThumbnailSoakMaxRHIGrowthMB(
+	TEXT("Thumbnail.Soak.MaxRHIGrowthMB"),
+	16.f,
+	TEXT("Texture memory in MB reported by the RHI the soak test tolerates gaining over its run."));
+
+static TAutoConsoleVariable<float> CVarThumbnailSoakMaxGCPauseMs(
+	TEXT("Thumbnail.Soak.MaxGCPauseMs"),
+	500.f,
+	TEXT("Longest garbage collection the soak test tolerates, including the full purges forced by preview world teardown."));
+
+namespace ThumbnailSoak
+{
+	// Idle cycles that only warm up shader, pool and allocator caches before the baseline is taken.
+	constexpr int32 WarmupCycles = 3;
+	// Frames an idle pipeline may take for callbacks launched on workers, or requests still being submitted by them, to come through.
+	constexpr int32 MaxUnfinishedFrames = 600;
+
+	struct FSample
+	{
+		double Time = 0.0;
+		int32 WorldContexts = 0;
+		int32 Objects = 0;
+		int32 Textures = 0;
+		int64 RHITextureBytes = 0;
+		uint64 UsedPhysical = 0;
+		int64 CacheBytes = 0;
+	};
+
+	struct FState : public TSharedFromThis<FState, ESPMode::ThreadSafe>
+	{
+		FAutomationTestBase* Test = nullptr;
+		FRandomStream Random;
+		double StartTime = 0.0;
+		double EndTime = 0.0;
+
+		TArray<TStrongObjectPtr<UStaticMesh>> Meshes;
+		TStrongObjectPtr<UMaterialInterface> Material;
+
+		// Results the test holds on to for a while, as a UI would. Callbacks can arrive on any thread.
+		FCriticalSection Mutex;
+		TArray<FThumbnailHandle> Handles;
+		TArray<UTextureRenderTarget2D*> RenderTargets;
+		std::atomic<int32> Delivered{ 0 };
+		std::atomic<int32> Failed{ 0 };
+		int32 Queued = 0;
+		// Requests whose final result came back, a progressive placeholder does not count.
+		std::atomic<int32> Finished{ 0 };
+		int32 UnfinishedFrames = 0;
+
+		int32 Cycle = 0;
+		int32 IdleFrames = 0;
+		int32 IdleFramesTarget = 0;
+		bool bBurstQueued = false;
+		TArray<FSample> Samples;
+
+		double GCStartTime = 0.0;
+		double MaxGCPause = 0.0;
+		double TotalGCPause = 0.0;
+		int32 NumGCs = 0;
+		FDelegateHandle PreGCHandle;
+		FDelegateHandle PostGCHandle;
+	};
+
+	static int64 GetRHITextureBytes()
+	{
+		FTextureMemoryStats stats;
+		RHIGetTextureMemoryStats(stats);
+		return stats.StreamingMemorySize + stats.NonStreamingMemorySize;
+	}
+
+	static FSample TakeSample(UThumbnailEngineSubsystem* service)
+	{
+		FSample sample;
+		sample.Time = FPlatformTime::Seconds();
+		sample.WorldContexts = GEngine->GetWorldContexts().Num();
+		sample.Objects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+		for (TObjectIterator<UTexture> it; it; ++it)
+		{
+			sample.Textures++;
+		}
+		sample.RHITextureBytes = GetRHITextureBytes();
+		sample.UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+		sample.CacheBytes = service->GetMemoryStats().TotalBytes;
+		return sample;
+	}
+
+	static FThumbnailPostProcess RandomPostProcess(FRandomStream& random)
+	{
+		FThumbnailPostProcess postProcess;
+		if (random.FRand() < 0.6f)
+		{
+			return postProcess;
+		}
+		postProcess.bPremultiplyAlpha = random.RandRange(0, 1) == 1;
+		postProcess.bTrimTransparentBorder = random.RandRange(0, 3) == 0;
+		postProcess.bFillBackground = random.RandRange(0, 1) == 1;
+		postProcess.BackgroundColor = FLinearColor(random.FRand(), random.FRand(), random.FRand());
+		postProcess.OutlineWidth = random.RandRange(0, 3);
+		postProcess.bDropShadow = random.RandRange(0, 1) == 1;
+		return postProcess;
+	}
+
+	static void QueueRandomRequest(FState& state, UThumbnailEngineSubsystem* service)
+	{
+		FRandomStream& random = state.Random;
+		static const int32 sizes[] = { 32, 64, 128, 256, 512 };
+		UStaticMesh* mesh = state.Meshes[random.RandRange(0, state.Meshes.Num() - 1)].Get();
+		const int32 numSizes = UE_ARRAY_COUNT(sizes);
+		const int32 sizeX = sizes[random.RandRange(0, numSizes - 1)];
+		const int32 sizeY = random.RandRange(0, 3) == 0 ? sizes[random.RandRange(0, numSizes - 1)] : sizeX;
+		const EThumbnailQualityProfile quality = (EThumbnailQualityProfile)random.RandRange(0, 2);
+		const int32 outputRoll = random.RandRange(0, 9);
+		const EThumbnailOutputMode outputMode = outputRoll < 6 ? EThumbnailOutputMode::Texture2D : outputRoll < 8 ? EThumbnailOutputMode::RenderTarget : EThumbnailOutputMode::Pixels;
+		const EThumbnailCallbackThread callbackThread = (EThumbnailCallbackThread)random.RandRange(0, 2);
+		const bool bPin = random.RandRange(0, 2) == 0;
+		TWeakPtr<FState, ESPMode::ThreadSafe> weakState = state.AsShared();
+		state.Queued++;
+
+		// Textures are counted through the handle, OnComplete also fires for progressive placeholders.
+		auto onHandle = [weakState, bPin](const FThumbnailHandle& handle)
+		{
+			if (TSharedPtr<FState, ESPMode::ThreadSafe> pinned = weakState.Pin())
+			{
+				(handle.IsValid() ? pinned->Delivered : pinned->Failed)++;
+				pinned->Finished++;
+				if (bPin && handle.IsValid())
+				{
+					FScopeLock lock(&pinned->Mutex);
+					pinned->Handles.Add(handle);
+				}
+			}
+		};
+		auto onRenderTarget = [weakState](UTextureRenderTarget2D* target)
+		{
+			if (TSharedPtr<FState, ESPMode::ThreadSafe> pinned = weakState.Pin())
+			{
+				(target ? pinned->Delivered : pinned->Failed)++;
+				pinned->Finished++;
+				if (target)
+				{
+					FScopeLock lock(&pinned->Mutex);
+					pinned->RenderTargets.Add(target);
+				}
+			}
+		};
+		auto onPixels = [weakState](const FThumbnailPixels& pixels)
+		{
+			if (TSharedPtr<FState, ESPMode::ThreadSafe> pinned = weakState.Pin())
+			{
+				(pixels.bSuccess ? pinned->Delivered : pinned->Failed)++;
+				pinned->Finished++;
+			}
+		};
+
+		FThumbnailPixelRequest pixelRequest;
+		pixelRequest.Format = (EThumbnailPixelFormat)random.RandRange(0, 3);
+		pixelRequest.Encoding = random.RandRange(0, 4) == 0 ? EThumbnailImageEncoding::PNG : EThumbnailImageEncoding::None;
+		const FThumbnailPostProcess postProcess = RandomPostProcess(random);
+
+		// Some requests come in through the lock-free submission path from a worker, like a streaming loader would.
+		if (random.RandRange(0, 3) == 0)
+		{
+			FThumbnailSubmission submission;
+			submission.Asset.Reset(mesh);
+			submission.SizeX = sizeX;
+			submission.SizeY = sizeY;
+			submission.OutputMode = outputMode;
+			submission.QualityProfile = quality;
+			submission.CallbackThread = callbackThread;
+			submission.Priority = random.RandRange(-2, 2);
+			submission.bProgressive = outputMode == EThumbnailOutputMode::Texture2D && random.RandRange(0, 1) == 1;
+			submission.OnHandleComplete.BindLambda(onHandle);
+			submission.OnRenderTargetComplete.BindLambda(onRenderTarget);
+			submission.PixelRequest = pixelRequest;
+			submission.OnPixelsComplete.BindLambda(onPixels);
+			submission.PostProcess = postProcess;
+			UE::Tasks::Launch(UE_SOURCE_LOCATION, [service, submission = MoveTemp(submission)]() mutable
+			{
+				service->SubmitThumbnail(MoveTemp(submission));
+			});
+			return;
+		}
+
+		FThumbnailRequest* entry = service->QueueMeshThumbnail(mesh);
+		if (!entry)
+		{
+			state.Queued--;
+			return;
+		}
+		entry->SizeX = sizeX;
+		entry->SizeY = sizeY;
+		entry->OutputMode = outputMode;
+		entry->QualityProfile = quality;
+		entry->CallbackThread = callbackThread;
+		entry->Priority = random.RandRange(-2, 2);
+		entry->bProgressive = outputMode == EThumbnailOutputMode::Texture2D && random.RandRange(0, 1) == 1;
+		entry->OnHandleComplete.BindLambda(onHandle);
+		entry->OnRenderTargetComplete.BindLambda(onRenderTarget);
+		entry->PixelRequest = pixelRequest;
+		entry->OnPixelsComplete.BindLambda(onPixels);
+		entry->PostProcess = postProcess;
+		if (state.Material && random.RandRange(0, 2) == 0)
+		{
+			FThumbnailMaterialOverride& materialOverride = entry->MaterialOverrides.AddDefaulted_GetRef();
+			materialOverride.Material = state.Material.Get();
+			materialOverride.VectorParameters.Add(TEXT("Color"), FLinearColor(random.FRand(), random.FRand(), random.FRand()));
+		}
+	}
+
+	// Drops a random share of the results held on to, the rest stay pinned into the next burst.
+	static void ReleaseResults(FState& state, UThumbnailEngineSubsystem* service, float share)
+	{
+		TArray<UTextureRenderTarget2D*> released;
+		{
+			FScopeLock lock(&state.Mutex);
+			for (int32 i = state.Handles.Num() - 1; i >= 0; i--)
+			{
+				if (state.Random.FRand() < share)
+				{
+					state.Handles.RemoveAtSwap(i);
+				}
+			}
+			for (int32 i = state.RenderTargets.Num() - 1; i >= 0; i--)
+			{
+				if (state.Random.FRand() < share)
+				{
+					released.Add(state.RenderTargets[i]);
+					state.RenderTargets.RemoveAtSwap(i);
+				}
+			}
+		}
+		for (UTextureRenderTarget2D* target : released)
+		{
+			service->ReleaseRenderTarget(target);
+		}
+	}
+
+	// True once every queued request has come back and the pool holds none of them. Gives up with an error after
+	// MaxUnfinishedFrames, so a lost request fails the test instead of stalling it.
+	static bool AllRequestsFinished(FState& state, UThumbnailEngineSubsystem* service)
+	{
+		const int32 finished = state.Finished.load();
+		if (finished < state.Queued && ++state.UnfinishedFrames <= MaxUnfinishedFrames)
+		{
+			return false;
+		}
+		if (finished != state.Queued)
+		{
+			state.Test->AddError(FString::Printf(TEXT("Cycle %d: %d of %d requests never delivered a final result."), state.Cycle, state.Queued - finished, state.Queued));
+			state.Finished = state.Queued;
+		}
+		if (service->GetNumRequestsInUse() != 0)
+		{
+			state.Test->AddError(FString::Printf(TEXT("Cycle %d: %d requests still held by the pool with the pipeline idle."), state.Cycle, service->GetNumRequestsInUse()));
+		}
+		state.UnfinishedFrames = 0;
+		return true;
+	}
+
+	static void Report(FState& state)
+	{
+		FAutomationTestBase& test = *state.Test;
+		test.AddInfo(FString::Printf(TEXT("%d cycles, %d requests, %d delivered, %d failed, %d GCs, max GC pause %.1f ms, average %.1f ms."),
+			state.Cycle, state.Queued, state.Delivered.load(), state.Failed.load(), state.NumGCs,
+			state.MaxGCPause * 1000.0, state.NumGCs > 0 ? state.TotalGCPause * 1000.0 / state.NumGCs : 0.0));
+
+		if (state.Samples.Num() <= WarmupCycles)
+		{
+			test.AddError(FString::Printf(TEXT("Only %d idle cycles completed, the soak needs more than %d to measure growth. Raise Thumbnail.Soak.Minutes."),
+				state.Samples.Num(), WarmupCycles));
+			return;
+		}
+
+		// Compare the lowest value over the last quarter of the run against the baseline, so a cycle that happened to
+		// sample right before the allocator or the RHI released memory does not read as a leak.
+		const FSample& baseline = state.Samples[WarmupCycles - 1];
+		const int32 tailStart = FMath::Max(WarmupCycles, state.Samples.Num() - FMath::Max(1, (state.Samples.Num() - WarmupCycles) / 4));
+		FSample tail = state.Samples.Last();
+		for (int32 i = tailStart; i < state.Samples.Num(); i++)
+		{
+			const FSample& sample = state.Samples[i];
+			tail.WorldContexts = FMath::Min(tail.WorldContexts, sample.WorldContexts);
+			tail.Objects = FMath::Min(tail.Objects, sample.Objects);
+			tail.Textures = FMath::Min(tail.Textures, sample.Textures);
+			tail.RHITextureBytes = FMath::Min(tail.RHITextureBytes, sample.RHITextureBytes);
+			tail.UsedPhysical = FMath::Min(tail.UsedPhysical, sample.UsedPhysical);
+		}
+		test.AddInfo(FString::Printf(TEXT("Growth over %.1f minutes: %d world contexts, %d objects, %d textures, %.2f MB RHI textures, %.2f MB physical (not checked)."),
+			(tail.Time - baseline.Time) / 60.0, tail.WorldContexts - baseline.WorldContexts, tail.Objects - baseline.Objects, tail.Textures - baseline.Textures,
+			(tail.RHITextureBytes - baseline.RHITextureBytes) / (1024.0 * 1024.0), ((int64)tail.UsedPhysical - (int64)baseline.UsedPhysical) / (1024.0 * 1024.0)));
+
+		test.TestTrue(TEXT("Preview world contexts are destroyed with the scene"), tail.WorldContexts <= baseline.WorldContexts);
+		test.TestTrue(TEXT("UObject count stays within Thumbnail.Soak.MaxObjectGrowth"), tail.Objects - baseline.Objects <= CVarThumbnailSoakMaxObjectGrowth.GetValueOnGameThread());
+		test.TestTrue(TEXT("Texture count stays within Thumbnail.Soak.MaxTextureGrowth"), tail.Textures - baseline.Textures <= CVarThumbnailSoakMaxTextureGrowth.GetValueOnGameThread());
+		test.TestTrue(TEXT("RHI texture memory stays within Thumbnail.Soak.MaxRHIGrowthMB"),
+			tail.RHITextureBytes - baseline.RHITextureBytes <= (int64)(CVarThumbnailSoakMaxRHIGrowthMB.GetValueOnGameThread() * 1024.f * 1024.f));
+		test.TestTrue(TEXT("GC pauses stay within Thumbnail.Soak.MaxGCPauseMs"), state.MaxGCPause * 1000.0 <= CVarThumbnailSoakMaxGCPauseMs.GetValueOnGameThread());
+	}
+}
+
+/**
+ * Alternates bursts of randomized requests with idle periods long enough for the preview world to be torn down. After
+ * every idle cycle all results are released, the cache is trimmed and a full GC is run before world contexts, UObjects,
+ * textures and RHI texture memory are sampled. Fails when any of them grows past its Thumbnail.Soak.* threshold.
+ */
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FThumbnailSoakCommand, TSharedRef<ThumbnailSoak::FState, ESPMode::ThreadSafe>, State);
+bool FThumbnailSoakCommand::Update()
+{
+	using namespace ThumbnailSoak;
+	FState& state = *State;
+	UThumbnailEngineSubsystem* service = GEngine ? GEngine->GetEngineSubsystem<UThumbnailEngineSubsystem>() : nullptr;
+	if (!service)
+	{
+		FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(state.PreGCHandle);
+		FCoreUObjectDelegates::GetPostGarbageCollect().Remove(state.PostGCHandle);
+		state.Test->AddError(TEXT("The thumbnail engine subsystem went away during the soak."));
+		return true;
+	}
+	const bool bTimeUp = FPlatformTime::Seconds() >= state.EndTime;
+
+	if (!state.bBurstQueued && !bTimeUp)
+	{
+		const int32 count = state.Random.RandRange(1, 24);
+		for (int32 i = 0; i < count; i++)
+		{
+			QueueRandomRequest(state, service);
+		}
+		state.bBurstQueued = true;
+		state.IdleFrames = 0;
+		state.IdleFramesTarget = state.Random.RandRange(2, 30);
+		return false;
+	}
+
+	if (!service->IsIdle())
+	{
+		// Results come and go while the queue is still working, and now and then more requests join a live scene.
+		ReleaseResults(state, service, 0.02f);
+		if (!bTimeUp && state.Random.RandRange(0, 59) == 0)
+		{
+			QueueRandomRequest(state, service);
+		}
+		return false;
+	}
+
+	// Checked once per idle point, the pipeline stays idle while the idle frames below are counted.
+	if (state.IdleFrames == 0 && !AllRequestsFinished(state, service))
+	{
+		return false;
+	}
+
+	if (bTimeUp)
+	{
+		ReleaseResults(state, service, 1.f);
+		FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(state.PreGCHandle);
+		FCoreUObjectDelegates::GetPostGarbageCollect().Remove(state.PostGCHandle);
+		Report(state);
+		return true;
+	}
+
+	// Sit idle for a few frames so the teardown's forced GC runs before we add our own.
+	if (++state.IdleFrames < state.IdleFramesTarget)
+	{
+		return false;
+	}
+
+	ReleaseResults(state, service, 1.f);
+	service->TrimUnreferencedThumbnails();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+	FlushRenderingCommands();
+	state.Samples.Add(TakeSample(service));
+	state.Cycle++;
+	state.bBurstQueued = false;
+
+	const FSample& sample = state.Samples.Last();
+	UE_LOG(LogThumbnail, Display, TEXT("Soak cycle %d at %.0f s: %d world contexts, %d objects, %d textures, %.2f MB RHI textures, %.2f MB physical, %lld cache bytes."),
+		state.Cycle, sample.Time - state.StartTime, sample.WorldContexts, sample.Objects, sample.Textures,
+		sample.RHITextureBytes / (1024.0 * 1024.0), sample.UsedPhysical / (1024.0 * 1024.0), sample.CacheBytes);
+	return false;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FThumbnailSoakTest, "ThumbnailPlugin.Soak.PreviewWorldLifetime",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::StressFilter)
+
+bool FThumbnailSoakTest::RunTest(const FString& Parameters)
+{
+	using namespace ThumbnailSoak;
+	if (!FApp::CanEverRender())
+	{
+		AddWarning(TEXT("The soak test renders thumbnails and needs an RHI, run it with -RenderOffscreen instead of -NullRHI."));
+		return true;
+	}
+	UThumbnailEngineSubsystem* service = GEngine ? GEngine->GetEngineSubsystem<UThumbnailEngineSubsystem>() : nullptr;
+	if (!TestNotNull(TEXT("Thumbnail engine subsystem"), service))
+	{
+		return false;
+	}
+
+	TSharedRef<FState, ESPMode::ThreadSafe> state = MakeShared<FState, ESPMode::ThreadSafe>();
+	state->Test = this;
+	const int32 seed = CVarThumbnailSoakSeed.GetValueOnGameThread() != 0 ? CVarThumbnailSoakSeed.GetValueOnGameThread() : (int32)(FPlatformTime::Cycles() & 0x7fffffff);
+	state->Random.Initialize(seed);
+	AddInfo(FString::Printf(TEXT("Seed %d, set Thumbnail.Soak.Seed to replay."), seed));
+
+	static const TCHAR* meshPaths[] = {
+		TEXT("/Engine/BasicShapes/Cube.Cube"),
+		TEXT("/Engine/BasicShapes/Sphere.Sphere"),
+		TEXT("/Engine/BasicShapes/Cylinder.Cylinder"),
+		TEXT("/Engine/BasicShapes/Cone.Cone"),
+		TEXT("/Engine/BasicShapes/Plane.Plane")
+	};
+	for (const TCHAR* path : meshPaths)
+	{
+		if (UStaticMesh* mesh = LoadObject<UStaticMesh>(nullptr, path))
+		{
+			state->Meshes.Emplace(mesh);
+		}
+	}
+	if (!TestTrue(TEXT("Engine basic shapes loaded"), state->Meshes.Num() > 0))
+	{
+		return false;
+	}
+	state->Material.Reset(LoadObject<UMaterialInterface>(nullptr, TEXT("/Engine/BasicShapes/BasicShapeMaterial.BasicShapeMaterial")));
+
+	// Start from a clean pipeline so the warmup cycles measure our own growth only.
+	service->TrimUnreferencedThumbnails();
+	state->StartTime = FPlatformTime::Seconds();
+	state->EndTime = state->StartTime + CVarThumbnailSoakMinutes.GetValueOnGameThread() * 60.0;
+
+	// Weak, an aborted test leaves these bound without a state behind them.
+	TWeakPtr<FState, ESPMode::ThreadSafe> weakState = state;
+	state->PreGCHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddLambda([weakState]()
+	{
+		if (TSharedPtr<FState, ESPMode::ThreadSafe> pinned = weakState.Pin())
+		{
+			pinned->GCStartTime = FPlatformTime::Seconds();
+		}
+	});
+	state->PostGCHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddLambda([weakState]()
+	{
+		if (TSharedPtr<FState, ESPMode::ThreadSafe> pinned = weakState.Pin())
+		{
+			const double pause = FPlatformTime::Seconds() - pinned->GCStartTime;
+			pinned->MaxGCPause = FMath::Max(pinned->MaxGCPause, pause);
+			pinned->TotalGCPause += pause;
+			pinned->NumGCs++;
+		}
+	});
+
+	ADD_LATENT_AUTOMATION_COMMAND(FThumbnailSoakCommand(state));
+	return true;
+}
+
+#endif
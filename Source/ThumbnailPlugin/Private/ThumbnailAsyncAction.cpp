@@ -4,23 +4,65 @@
 
 
 
-UThumbnailAsyncAction* UThumbnailAsyncAction::GetStaticMeshThumbnail(const UObject* WorldContext, UStaticMesh* inMesh, int32 sizeX, int32 sizeY)
+UThumbnailAsyncAction* UThumbnailAsyncAction::GetStaticMeshThumbnail(const UObject* WorldContext, UStaticMesh* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, const FThumbnailPostProcess& postProcess, int32 sizeX, int32 sizeY, EThumbnailQualityProfile quality, UThumbnailLightingPreset* lightingPreset, int32 priority, bool bProgressive)
 {
-	return GetThumbnail(WorldContext, inMesh, sizeX, sizeY);
+	return GetThumbnail(WorldContext, inMesh, materialOverrides, postProcess, sizeX, sizeY, quality, lightingPreset, priority, bProgressive);
 }
-UThumbnailAsyncAction* UThumbnailAsyncAction::GetSkeletalMeshThumbnail(const UObject* WorldContext, USkeletalMesh* inMesh, int32 sizeX, int32 sizeY)
+UThumbnailAsyncAction* UThumbnailAsyncAction::GetSkeletalMeshThumbnail(const UObject* WorldContext, USkeletalMesh* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, const FThumbnailPostProcess& postProcess, int32 sizeX, int32 sizeY, EThumbnailQualityProfile quality, UThumbnailLightingPreset* lightingPreset, int32 priority, bool bProgressive)
 {
-	return GetThumbnail(WorldContext, inMesh, sizeX, sizeY);
+	return GetThumbnail(WorldContext, inMesh, materialOverrides, postProcess, sizeX, sizeY, quality, lightingPreset, priority, bProgressive);
+}
+UThumbnailAsyncAction* UThumbnailAsyncAction::GetCompositeThumbnail(const UObject* WorldContext, const TArray<FThumbnailPart>& parts, const TArray<FThumbnailMaterialOverride>& materialOverrides, const FThumbnailPostProcess& postProcess, int32 sizeX, int32 sizeY, EThumbnailQualityProfile quality, UThumbnailLightingPreset* lightingPreset, int32 priority, bool bProgressive)
+{
+	return GetThumbnail(WorldContext, parts, materialOverrides, postProcess, sizeX, sizeY, quality, lightingPreset, priority, bProgressive);
 }
 void UThumbnailAsyncAction::OnThumbnailComplete(UTexture2D* inTexture)
 {
 	ThumbnailCompleteEvent.Broadcast(inTexture);
 }
+void UThumbnailAsyncAction::OnThumbnailFinal(const FThumbnailHandle& handle)
+{
+	RequestHandle = FThumbnailRequestHandle();
+	SetReadyToDestroy();
+}
 void UThumbnailAsyncAction::Activate()
 {
 
 }
 void UThumbnailAsyncAction::Cancel()
+{
+	if (UThumbnailSubsystem* subsystem = Subsystem.Get())
+	{
+		subsystem->CancelRequest(RequestHandle);
+	}
+	RequestHandle = FThumbnailRequestHandle();
+	Super::Cancel();
+}
+
+UThumbnailRenderTargetAsyncAction* UThumbnailRenderTargetAsyncAction::GetStaticMeshThumbnailRenderTarget(const UObject* WorldContext, UStaticMesh* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, int32 sizeX, int32 sizeY, EThumbnailQualityProfile quality, UThumbnailLightingPreset* lightingPreset)
+{
+	return GetThumbnail(WorldContext, inMesh, materialOverrides, sizeX, sizeY, quality, lightingPreset);
+}
+UThumbnailRenderTargetAsyncAction* UThumbnailRenderTargetAsyncAction::GetSkeletalMeshThumbnailRenderTarget(const UObject* WorldContext, USkeletalMesh* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, int32 sizeX, int32 sizeY, EThumbnailQualityProfile quality, UThumbnailLightingPreset* lightingPreset)
+{
+	return GetThumbnail(WorldContext, inMesh, materialOverrides, sizeX, sizeY, quality, lightingPreset);
+}
+void UThumbnailRenderTargetAsyncAction::OnThumbnailComplete(UTextureRenderTarget2D* inRenderTarget)
+{
+	ThumbnailCompleteEvent.Broadcast(inRenderTarget);
+	RequestHandle = FThumbnailRequestHandle();
+	SetReadyToDestroy();
+}
+void UThumbnailRenderTargetAsyncAction::Activate()
 {
 
-}
\ No newline at end of file
+}
+void UThumbnailRenderTargetAsyncAction::Cancel()
+{
+	if (UThumbnailSubsystem* subsystem = Subsystem.Get())
+	{
+		subsystem->CancelRequest(RequestHandle);
+	}
+	RequestHandle = FThumbnailRequestHandle();
+	Super::Cancel();
+}
@@ -0,0 +1,421 @@
+#include "ThumbnailCache.h"
+#include "Engine/Texture.h"
+#include "ThumbnailDownsample.h"
+#include "ThumbnailImageHash.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+bool FThumbnailDependency::IsCurrent() const
+{
+	UPackage* package = Package.Get();
+	if (!package || FindPackage(nullptr, *PackageName.ToString()) != package)
+	{
+		return false;
+	}
+#if WITH_EDITORONLY_DATA
+	return package->GetSavedHash() == SavedHash;
+#else
+	return true;
+#endif
+}
+
+TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> FThumbnailCache::Find(const FThumbnailCacheKey& key)
+{
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>* record = Records.Find(key);
+	if (!record)
+	{
+		return Revive(key);
+	}
+	if (!(*record)->Texture)
+	{
+		Evict(key);
+		return nullptr;
+	}
+	(*record)->LastUsedTime = FPlatformTime::Seconds();
+	return *record;
+}
+FThumbnailHandle FThumbnailCache::FindByTexture(const UTexture* texture) const
+{
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		if (pair.Value->Texture == texture)
+		{
+			return FThumbnailHandle(pair.Value);
+		}
+	}
+	return FThumbnailHandle();
+}
+TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> FThumbnailCache::FindDownsampleSource(const FThumbnailCacheKey& key)
+{
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> best;
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		const FThumbnailCacheKey& other = pair.Key;
+		if (!pair.Value->Pixels.IsValid() || !other.IsSameRender(key))
+		{
+			continue;
+		}
+		if (other.SizeX == key.SizeX || !ThumbnailDownsample::CanDownsample(other.SizeX, other.SizeY, key.SizeX, key.SizeY))
+		{
+			continue;
+		}
+		if (!best.IsValid() || other.SizeX < best->Key.SizeX)
+		{
+			best = pair.Value;
+		}
+	}
+	if (best.IsValid())
+	{
+		best->LastUsedTime = FPlatformTime::Seconds();
+	}
+	return best;
+}
+UTexture* FThumbnailCache::FindIdentical(uint64 exactHash) const
+{
+	const FSharedImage* image = exactHash != 0 ? Images.Find(exactHash) : nullptr;
+	return image ? image->Texture : nullptr;
+}
+TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> FThumbnailCache::Add(const FThumbnailCacheKey& key, UTexture* texture, int64 bytes, TSharedPtr<const TArray64<uint8>, ESPMode::ThreadSafe> pixels,
+	TArray<FThumbnailDependency>&& dependencies, const FThumbnailImageHash& hash)
+{
+	Remove(key);
+	Released.Remove(key);
+
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> record = MakeShared<FThumbnailRecord, ESPMode::ThreadSafe>();
+	record->Key = key;
+	record->Hash = hash;
+	record->LastUsedTime = FPlatformTime::Seconds();
+	if (hash.Exact != 0)
+	{
+		// Only records that offered pixels get the shared ones, the others may be trimmed to a different size than their key.
+		const bool bKeepPixels = pixels.IsValid();
+		FSharedImage& image = Images.FindOrAdd(hash.Exact);
+		if (image.NumRecords == 0)
+		{
+			image.Texture = texture;
+			image.Bytes = bytes;
+			TotalBytes += bytes;
+		}
+		if (!image.Pixels.IsValid() && pixels.IsValid())
+		{
+			image.Bytes += pixels->Num();
+			TotalBytes += pixels->Num();
+			image.Pixels = MoveTemp(pixels);
+		}
+		image.NumRecords++;
+		record->Texture = image.Texture;
+		record->Pixels = bKeepPixels ? image.Pixels : nullptr;
+		record->Bytes = image.Bytes;
+	}
+	else
+	{
+		record->Texture = texture;
+		record->Bytes = bytes + (pixels.IsValid() ? pixels->Num() : 0);
+		record->Pixels = MoveTemp(pixels);
+		TotalBytes += record->Bytes;
+	}
+	record->Dependencies = MoveTemp(dependencies);
+	for (const FThumbnailDependency& dependency : record->Dependencies)
+	{
+		DependencyCounts.FindOrAdd(dependency.PackageName)++;
+	}
+	Records.Add(key, record);
+	return record;
+}
+void FThumbnailCache::Remove(const FThumbnailCacheKey& key)
+{
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> record;
+	if (Records.RemoveAndCopyValue(key, record))
+	{
+		FSharedImage* image = record->Hash.Exact != 0 ? Images.Find(record->Hash.Exact) : nullptr;
+		if (!image)
+		{
+			TotalBytes -= record->Bytes;
+		}
+		else if (--image->NumRecords <= 0)
+		{
+			// Handles still pointing at the records keep the texture alive, the cache no longer counts it.
+			TotalBytes -= image->Bytes;
+			Images.Remove(record->Hash.Exact);
+		}
+		for (const FThumbnailDependency& dependency : record->Dependencies)
+		{
+			int32* count = DependencyCounts.Find(dependency.PackageName);
+			if (count && --(*count) <= 0)
+			{
+				DependencyCounts.Remove(dependency.PackageName);
+			}
+		}
+		if (IsReferenced(record))
+		{
+			Orphans.Add(record);
+		}
+	}
+}
+void FThumbnailCache::Empty()
+{
+	TArray<FThumbnailCacheKey> keys;
+	Records.GetKeys(keys);
+	for (const FThumbnailCacheKey& key : keys)
+	{
+		Remove(key);
+	}
+	Released.Empty();
+}
+void FThumbnailCache::Evict(const FThumbnailCacheKey& key)
+{
+	if (const TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>* record = Records.Find(key); record && (*record)->Texture)
+	{
+		// Pixels are only kept for downsampling, they are dropped with the record.
+		FReleasedRecord& released = Released.Add(key);
+		released.Texture = (*record)->Texture.Get();
+		released.Bytes = (*record)->Bytes - ((*record)->Pixels.IsValid() ? (*record)->Pixels->Num() : 0);
+		released.Dependencies = (*record)->Dependencies;
+		released.Hash = (*record)->Hash;
+	}
+	Remove(key);
+	Evictions++;
+}
+TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> FThumbnailCache::Revive(const FThumbnailCacheKey& key)
+{
+	FReleasedRecord released;
+	if (!Released.RemoveAndCopyValue(key, released))
+	{
+		return nullptr;
+	}
+	UTexture* texture = released.Texture.Get();
+	if (!texture || released.Dependencies.ContainsByPredicate([](const FThumbnailDependency& dependency) { return !dependency.IsCurrent(); }))
+	{
+		return nullptr;
+	}
+	return Add(key, texture, released.Bytes, nullptr, MoveTemp(released.Dependencies), released.Hash);
+}
+void FThumbnailCache::EnforceBudget(int64 budgetBytes)
+{
+	if (TotalBytes <= budgetBytes)
+	{
+		return;
+	}
+
+	// Collect keys rather than records, holding extra references would make every candidate look pinned.
+	TArray<TPair<double, FThumbnailCacheKey>> candidates;
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		if (!IsReferenced(pair.Value))
+		{
+			candidates.Emplace(pair.Value->LastUsedTime, pair.Key);
+		}
+	}
+	candidates.Sort([](const TPair<double, FThumbnailCacheKey>& a, const TPair<double, FThumbnailCacheKey>& b)
+	{
+		return a.Key < b.Key;
+	});
+
+	for (const TPair<double, FThumbnailCacheKey>& candidate : candidates)
+	{
+		if (TotalBytes <= budgetBytes)
+		{
+			break;
+		}
+		Evict(candidate.Value);
+	}
+}
+int32 FThumbnailCache::TrimUnreferenced()
+{
+	TArray<FThumbnailCacheKey> unreferenced;
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		if (!IsReferenced(pair.Value))
+		{
+			unreferenced.Add(pair.Key);
+		}
+	}
+	for (const FThumbnailCacheKey& key : unreferenced)
+	{
+		Evict(key);
+	}
+	return unreferenced.Num();
+}
+int32 FThumbnailCache::InvalidatePackage(FName packageName)
+{
+	for (TMap<FThumbnailCacheKey, FReleasedRecord>::TIterator it = Released.CreateIterator(); it; ++it)
+	{
+		if (it.Value().Dependencies.ContainsByPredicate([packageName](const FThumbnailDependency& dependency) { return dependency.PackageName == packageName; }))
+		{
+			it.RemoveCurrent();
+		}
+	}
+	if (!DependencyCounts.Contains(packageName))
+	{
+		return 0;
+	}
+	TArray<FThumbnailCacheKey> invalid;
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		if (pair.Value->Dependencies.ContainsByPredicate([packageName](const FThumbnailDependency& dependency) { return dependency.PackageName == packageName; }))
+		{
+			invalid.Add(pair.Key);
+		}
+	}
+	for (const FThumbnailCacheKey& key : invalid)
+	{
+		Remove(key);
+	}
+	Invalidations += invalid.Num();
+	return invalid.Num();
+}
+int32 FThumbnailCache::ValidateDependencies()
+{
+	TArray<FThumbnailCacheKey> invalid;
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		if (pair.Value->Dependencies.ContainsByPredicate([](const FThumbnailDependency& dependency) { return !dependency.IsCurrent(); }))
+		{
+			invalid.Add(pair.Key);
+		}
+	}
+	for (const FThumbnailCacheKey& key : invalid)
+	{
+		Remove(key);
+	}
+	Invalidations += invalid.Num();
+	return invalid.Num();
+}
+TArray<FThumbnailDuplicateGroup> FThumbnailCache::GetDuplicateGroups(int32 maxPerceptualDistance) const
+{
+	TArray<FThumbnailDuplicateGroup> groups;
+
+	TMap<uint64, TArray<const FThumbnailRecord*>> byExactHash;
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		const FSharedImage* image = pair.Value->Hash.Exact != 0 ? Images.Find(pair.Value->Hash.Exact) : nullptr;
+		if (image && image->NumRecords > 1)
+		{
+			byExactHash.FindOrAdd(pair.Value->Hash.Exact).Add(pair.Value.Get());
+		}
+	}
+	for (const TPair<uint64, TArray<const FThumbnailRecord*>>& pair : byExactHash)
+	{
+		FThumbnailDuplicateGroup group;
+		group.bExact = true;
+		for (const FThumbnailRecord* record : pair.Value)
+		{
+			if (const UObject* asset = record->Key.Asset.ResolveObjectPtr())
+			{
+				group.Assets.AddUnique(FSoftObjectPath(asset));
+			}
+		}
+		// Several sizes or variants of one asset that happen to match are not content duplicates.
+		if (group.Assets.Num() > 1)
+		{
+			const FSharedImage& image = Images.FindChecked(pair.Key);
+			group.SharedBytesSaved = image.Bytes * (image.NumRecords - 1);
+			groups.Add(MoveTemp(group));
+		}
+	}
+
+	// One perceptual hash per asset, compared only against renders with the same quality, lighting and post processing.
+	struct FAssetHash
+	{
+		FSoftObjectPath Asset;
+		uint64 Perceptual = 0;
+		uint64 Exact = 0;
+	};
+	using FBucketKey = TTuple<EThumbnailQualityProfile, TObjectKey<UObject>, uint32>;
+	TMap<FBucketKey, TArray<FAssetHash>> buckets;
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		const FThumbnailCacheKey& key = pair.Key;
+		const UObject* asset = key.Asset.ResolveObjectPtr();
+		if (!asset || key.PartsHash != 0 || key.OverridesHash != 0 || pair.Value->Hash.Exact == 0)
+		{
+			continue;
+		}
+		TArray<FAssetHash>& bucket = buckets.FindOrAdd(FBucketKey(key.Quality, key.LightingPreset, key.PostProcessHash));
+		const FSoftObjectPath path(asset);
+		if (!bucket.ContainsByPredicate([&path](const FAssetHash& entry) { return entry.Asset == path; }))
+		{
+			bucket.Add({ path, pair.Value->Hash.Perceptual, pair.Value->Hash.Exact });
+		}
+	}
+	for (const TPair<FBucketKey, TArray<FAssetHash>>& pair : buckets)
+	{
+		const TArray<FAssetHash>& bucket = pair.Value;
+		TArray<bool> grouped;
+		grouped.SetNumZeroed(bucket.Num());
+		for (int32 i = 0; i < bucket.Num(); i++)
+		{
+			if (grouped[i])
+			{
+				continue;
+			}
+			FThumbnailDuplicateGroup group;
+			group.Assets.Add(bucket[i].Asset);
+			bool bAllIdentical = true;
+			for (int32 j = i + 1; j < bucket.Num(); j++)
+			{
+				if (!grouped[j] && ThumbnailImageHash::Distance(bucket[i].Perceptual, bucket[j].Perceptual) <= maxPerceptualDistance)
+				{
+					grouped[j] = true;
+					group.Assets.Add(bucket[j].Asset);
+					bAllIdentical &= bucket[j].Exact == bucket[i].Exact;
+				}
+			}
+			// Pixel identical groups are already reported above.
+			if (group.Assets.Num() > 1 && !bAllIdentical)
+			{
+				groups.Add(MoveTemp(group));
+			}
+		}
+	}
+	return groups;
+}
+void FThumbnailCache::AccumulateStats(FThumbnailMemoryStats& stats) const
+{
+	stats.TotalBytes += TotalBytes;
+	stats.Count += Records.Num();
+	stats.Evictions += Evictions;
+	stats.CacheHits += CacheHits;
+	stats.DownsampleHits += DownsampleHits;
+	stats.RerendersAvoided += CacheHits + DownsampleHits;
+	stats.Invalidations += Invalidations;
+	for (const TPair<uint64, FSharedImage>& pair : Images)
+	{
+		stats.SharedCount += pair.Value.NumRecords - 1;
+		stats.SharedBytesSaved += pair.Value.Bytes * (pair.Value.NumRecords - 1);
+	}
+	for (const TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		if (IsReferenced(pair.Value))
+		{
+			stats.ReferencedCount++;
+		}
+	}
+}
+void FThumbnailCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (TPair<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>>& pair : Records)
+	{
+		Collector.AddReferencedObject(pair.Value->Texture);
+	}
+	Orphans.RemoveAll([](const TWeakPtr<FThumbnailRecord, ESPMode::ThreadSafe>& orphan) { return !orphan.IsValid(); });
+	for (const TWeakPtr<FThumbnailRecord, ESPMode::ThreadSafe>& orphan : Orphans)
+	{
+		if (TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> record = orphan.Pin())
+		{
+			Collector.AddReferencedObject(record->Texture);
+		}
+	}
+	// Released textures are not referenced, those collected by the previous pass are forgotten here.
+	for (TMap<FThumbnailCacheKey, FReleasedRecord>::TIterator it = Released.CreateIterator(); it; ++it)
+	{
+		if (!it.Value().Texture.IsValid())
+		{
+			it.RemoveCurrent();
+		}
+	}
+}
+FString FThumbnailCache::GetReferencerName() const
+{
+	return TEXT("FThumbnailCache");
+}
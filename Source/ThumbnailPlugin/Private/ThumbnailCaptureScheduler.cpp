@@ -0,0 +1,37 @@
+#include "ThumbnailCaptureScheduler.h"
+#include "ThumbnailScene.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarThumbnailMaxCapturesInFlight(
+	TEXT("Thumbnail.MaxCapturesInFlight"),
+	2,
+	TEXT("Scene captures that may be submitted before the GPU has finished the earlier ones, at most 8."));
+
+static TAutoConsoleVariable<float> CVarThumbnailCaptureTimeStep(
+	TEXT("Thumbnail.CaptureTimeStep"),
+	1.f / 30.f,
+	TEXT("Seconds the preview world advances per scene capture, independent of the game's frame time."));
+
+bool FThumbnailCaptureScheduler::CanSubmit() const
+{
+	const int32 maxInFlight = FMath::Clamp(CVarThumbnailMaxCapturesInFlight.GetValueOnGameThread(), 1, MaxFences);
+	int32 inFlight = 0;
+	for (const FRenderCommandFence& fence : Fences)
+	{
+		inFlight += fence.IsFenceComplete() ? 0 : 1;
+	}
+	return inFlight < maxInFlight;
+}
+void FThumbnailCaptureScheduler::Submit(FThumbnailScene& scene)
+{
+	scene.Tick(FMath::Max(CVarThumbnailCaptureTimeStep.GetValueOnGameThread(), 0.f));
+	// Syncing to the RHI and GPU means the fence only passes once the capture has actually been drawn.
+	Fences[Next].BeginFence(true);
+	Next = (Next + 1) % MaxFences;
+	NumSubmitted++;
+}
+void FThumbnailCaptureScheduler::FenceOutstandingWork()
+{
+	// Moves the newest fence behind the extra work instead of taking a slot, it passes after the capture it replaces would have.
+	Fences[(Next + MaxFences - 1) % MaxFences].BeginFence(true);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderCommandFence.h"
+
+class FThumbnailScene;
+
+/**
+ * Paces scene captures on render thread and GPU progress instead of one capture per game frame.
+ * Every capture is fenced, and new ones may be submitted while fewer than Thumbnail.MaxCapturesInFlight fences
+ * are outstanding, so several settle captures can run within a single game frame when the GPU keeps up and
+ * none are queued when it does not. The preview world advances by a fixed step per capture, not by the game's frame time.
+ */
+class FThumbnailCaptureScheduler
+{
+public:
+	bool CanSubmit() const;
+
+	// Ticks the preview world, which issues the scene capture as render commands, then fences it.
+	void Submit(FThumbnailScene& scene);
+
+	// Fences render commands enqueued outside of a capture, such as readbacks and copies.
+	void FenceOutstandingWork();
+
+	int32 GetNumSubmitted() const { return NumSubmitted; };
+
+private:
+	static constexpr int32 MaxFences = 8;
+	// Render commands and GPU work complete in order, so the fences pass in the order they were begun and Next is the oldest.
+	FRenderCommandFence Fences[MaxFences];
+	int32 Next = 0;
+	int32 NumSubmitted = 0;
+};
@@ -0,0 +1,109 @@
+#include "ThumbnailDownsample.h"
+#include "Async/ParallelFor.h"
+#include "Math/VectorRegister.h"
+
+namespace ThumbnailDownsample
+{
+	struct FFilterTap
+	{
+		int32 Source;
+		float Weight;
+	};
+
+	// Taps for every destination pixel laid out back to back, Offsets[i]..Offsets[i + 1] belong to destination i.
+	struct FFilterTaps
+	{
+		TArray<FFilterTap> Taps;
+		TArray<int32> Offsets;
+	};
+
+	static FFilterTaps BuildTaps(int32 sourceSize, int32 destSize)
+	{
+		FFilterTaps result;
+		result.Offsets.Reserve(destSize + 1);
+
+		const double scale = (double)sourceSize / destSize;
+		const float normalize = (float)(1.0 / scale);
+		for (int32 d = 0; d < destSize; d++)
+		{
+			result.Offsets.Add(result.Taps.Num());
+			const double start = d * scale;
+			const double end = start + scale;
+			for (int32 s = FMath::FloorToInt(start); s < FMath::Min(FMath::CeilToInt(end), sourceSize); s++)
+			{
+				const double coverage = FMath::Min<double>(end, s + 1) - FMath::Max<double>(start, s);
+				if (coverage > 0)
+				{
+					result.Taps.Add({ s, (float)coverage * normalize });
+				}
+			}
+		}
+		result.Offsets.Add(result.Taps.Num());
+		return result;
+	}
+
+	bool CanDownsample(int32 sourceX, int32 sourceY, int32 destX, int32 destY)
+	{
+		return destX > 0 && destY > 0 && destX <= sourceX && destY <= sourceY && (int64)sourceX * destY == (int64)sourceY * destX;
+	}
+
+	void Downsample(const FFloat16Color* source, int32 sourceX, int32 sourceY, FFloat16Color* dest, int32 destX, int32 destY)
+	{
+		if (sourceX == destX && sourceY == destY)
+		{
+			FMemory::Memcpy(dest, source, (int64)destX * destY * sizeof(FFloat16Color));
+			return;
+		}
+		const FFilterTaps horizontal = BuildTaps(sourceX, destX);
+		const FFilterTaps vertical = BuildTaps(sourceY, destY);
+
+		// Horizontal pass, every source row shrinks to destX float pixels.
+		TArray<FLinearColor> intermediate;
+		intermediate.SetNumUninitialized(destX * sourceY);
+		ParallelFor(sourceY, [&](int32 y)
+		{
+			TArray<FLinearColor, TInlineAllocator<1024>> row;
+			row.SetNumUninitialized(sourceX);
+			const FFloat16Color* sourceRow = source + (int64)y * sourceX;
+			for (int32 x = 0; x < sourceX; x++)
+			{
+				row[x] = FLinearColor(sourceRow[x]);
+			}
+
+			FLinearColor* outRow = intermediate.GetData() + (int64)y * destX;
+			for (int32 x = 0; x < destX; x++)
+			{
+				VectorRegister4Float sum = VectorZeroFloat();
+				for (int32 t = horizontal.Offsets[x]; t < horizontal.Offsets[x + 1]; t++)
+				{
+					const FFilterTap& tap = horizontal.Taps[t];
+					sum = VectorMultiplyAdd(VectorLoad(&row[tap.Source].R), VectorSetFloat1(tap.Weight), sum);
+				}
+				VectorStore(sum, &outRow[x].R);
+			}
+		});
+
+		// Vertical pass, whole rows are accumulated so consecutive pixels stay in consecutive registers.
+		ParallelFor(destY, [&](int32 y)
+		{
+			TArray<FLinearColor, TInlineAllocator<1024>> accumulated;
+			accumulated.SetNumZeroed(destX);
+			for (int32 t = vertical.Offsets[y]; t < vertical.Offsets[y + 1]; t++)
+			{
+				const FFilterTap& tap = vertical.Taps[t];
+				const VectorRegister4Float weight = VectorSetFloat1(tap.Weight);
+				const FLinearColor* inRow = intermediate.GetData() + (int64)tap.Source * destX;
+				for (int32 x = 0; x < destX; x++)
+				{
+					VectorStore(VectorMultiplyAdd(VectorLoad(&inRow[x].R), weight, VectorLoad(&accumulated[x].R)), &accumulated[x].R);
+				}
+			}
+
+			FFloat16Color* outRow = dest + (int64)y * destX;
+			for (int32 x = 0; x < destX; x++)
+			{
+				outRow[x] = FFloat16Color(accumulated[x]);
+			}
+		});
+	}
+}
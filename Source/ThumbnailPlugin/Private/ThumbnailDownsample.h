@@ -0,0 +1,16 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace ThumbnailDownsample
+{
+	// Sizes must share an aspect ratio for the result to look right, the filter itself does not require it.
+	bool CanDownsample(int32 sourceX, int32 sourceY, int32 destX, int32 destY);
+
+	/**
+	 * Separable area (box) filter from a larger float16 RGBA image to a smaller one. Each destination pixel is the
+	 * coverage weighted average of the source pixels under it, so non integer ratios such as 256 -> 96 are exact. Equal sizes are copied.
+	 * Both passes work on whole pixels in SIMD registers and are split across ParallelFor workers by row.
+	 */
+	void Downsample(const FFloat16Color* source, int32 sourceX, int32 sourceY, FFloat16Color* dest, int32 destX, int32 destY);
+}
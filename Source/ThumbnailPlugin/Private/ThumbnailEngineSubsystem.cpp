@@ -0,0 +1,1209 @@
+#include "ThumbnailEngineSubsystem.h"
+#include "ThumbnailScene.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "GeometryCollection/GeometryCollection.h"
+#include "Actors/RenderActor.h"
+#include "ThumbnailReadback.h"
+#include "ThumbnailCaptureScheduler.h"
+#include "ThumbnailLightingPreset.h"
+#include "ThumbnailDownsample.h"
+#include "ThumbnailImageHash.h"
+#include "ThumbnailTimeline.h"
+#include "Tasks/Task.h"
+#include "Compression/OodleDataCompressionUtil.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "RenderUtils.h"
+#include "Misc/CoreDelegates.h"
+#include "Async/Async.h"
+#include "UObject/UObjectGlobals.h"
+#include "ThumbnailPlugin.h"
+
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+
+static TAutoConsoleVariable<int32> CVarThumbnailMemoryBudgetMB(
+	TEXT("Thumbnail.MemoryBudgetMB"),
+	128,
+	TEXT("Memory budget in MB for cached thumbnail textures and pooled render targets. Unreferenced thumbnails are evicted once it is exceeded."));
+
+static TAutoConsoleVariable<int32> CVarThumbnailMaxCapturesPerTick(
+	TEXT("Thumbnail.MaxCapturesPerTick"),
+	4,
+	TEXT("Upper bound on settle captures submitted per game frame. Fewer are submitted while Thumbnail.MaxCapturesInFlight captures are still on the GPU."));
+
+static TAutoConsoleVariable<bool> CVarThumbnailDownsampleFromCache(
+	TEXT("Thumbnail.DownsampleFromCache"),
+	true,
+	TEXT("Keep the pixels of cached thumbnails and derive smaller sizes of the same mesh from them instead of rendering again."));
+
+static TAutoConsoleVariable<int32> CVarThumbnailPlaceholderSize(
+	TEXT("Thumbnail.PlaceholderSize"),
+	32,
+	TEXT("Longest side in pixels of the unlit placeholder rendered first for progressive requests."));
+
+static TAutoConsoleVariable<int32> CVarThumbnailPlaceholdersPerTick(
+	TEXT("Thumbnail.PlaceholdersPerTick"),
+	8,
+	TEXT("Number of progressive placeholders captured per game frame, they count against Thumbnail.MaxCapturesPerTick. 0 disables placeholders."));
+
+static TAutoConsoleVariable<int32> CVarThumbnailPerceptualDuplicateDistance(
+	TEXT("Thumbnail.PerceptualDuplicateDistance"),
+	4,
+	TEXT("Bits out of 64 two perceptual thumbnail hashes may differ by for the assets to be reported as near duplicates."));
+
+static FAutoConsoleCommand ThumbnailReportDuplicatesCommand(
+	TEXT("Thumbnail.ReportDuplicates"),
+	TEXT("Logs groups of assets whose cached thumbnails are identical or look the same."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		UThumbnailEngineSubsystem* subsystem = GEngine ? GEngine->GetEngineSubsystem<UThumbnailEngineSubsystem>() : nullptr;
+		if (!subsystem)
+		{
+			return;
+		}
+		const TArray<FThumbnailDuplicateGroup> groups = subsystem->GetDuplicateGroups();
+		UE_LOG(LogThumbnail, Display, TEXT("%d duplicate thumbnail groups."), groups.Num());
+		for (const FThumbnailDuplicateGroup& group : groups)
+		{
+			if (group.bExact)
+			{
+				UE_LOG(LogThumbnail, Display, TEXT("Identical, %lld bytes shared:"), group.SharedBytesSaved);
+			}
+			else
+			{
+				UE_LOG(LogThumbnail, Display, TEXT("Look alike:"));
+			}
+			for (const FSoftObjectPath& asset : group.Assets)
+			{
+				UE_LOG(LogThumbnail, Display, TEXT("    %s"), *asset.ToString());
+			}
+		}
+	}));
+
+static FAutoConsoleCommand ThumbnailDumpTimelinesCommand(
+	TEXT("Thumbnail.DumpTimelines"),
+	TEXT("Logs per stage timings of the latest thumbnail requests (default 20) and p50/p95/p99 per stage, asset type and size."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args)
+	{
+		if (UThumbnailEngineSubsystem* subsystem = GEngine ? GEngine->GetEngineSubsystem<UThumbnailEngineSubsystem>() : nullptr)
+		{
+			subsystem->DumpTimelines(args.Num() > 0 ? FCString::Atoi(*args[0]) : 20);
+		}
+	}));
+
+static FAutoConsoleCommand ThumbnailValidateCacheCommand(
+	TEXT("Thumbnail.ValidateCache"),
+	TEXT("Drops cached thumbnails whose meshes, materials, textures or lighting presets were reloaded or saved with different content."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		if (UThumbnailEngineSubsystem* subsystem = GEngine ? GEngine->GetEngineSubsystem<UThumbnailEngineSubsystem>() : nullptr)
+		{
+			UE_LOG(LogThumbnail, Display, TEXT("Dropped %d stale thumbnails."), subsystem->ValidateCache());
+		}
+	}));
+
+namespace
+{
+	// Pixels are delivered on a worker and the views die with the call, so the game thread gets its own copy.
+	FOnThumbnailPixels MarshalToGameThread(FOnThumbnailPixels&& onPixels)
+	{
+		return FOnThumbnailPixels::CreateLambda([onPixels = MoveTemp(onPixels)](const FThumbnailPixels& pixels)
+		{
+			TArray<uint8> pixelData(pixels.Pixels.GetData(), pixels.Pixels.Num());
+			TArray<uint8> encoded(pixels.Encoded.GetData(), pixels.Encoded.Num());
+			AsyncTask(ENamedThreads::GameThread, [onPixels, result = pixels, pixelData = MoveTemp(pixelData), encoded = MoveTemp(encoded)]() mutable
+			{
+				result.Pixels = pixelData;
+				result.Encoded = encoded;
+				onPixels.ExecuteIfBound(result);
+			});
+		});
+	}
+}
+
+void UThumbnailEngineSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+
+	TickDelegate = FTickerDelegate::CreateUObject(this, &UThumbnailEngineSubsystem::ThumbnailTick);
+	
+
+	RenderTarget = NewObject<UTextureRenderTarget2D>(GetTransientPackage());
+	RenderTarget->RenderTargetFormat = RTF_RGBA16f;
+	RenderTarget->Filter = TextureFilter::TF_MAX;
+	RenderTarget->ClearColor = FLinearColor::Transparent;
+	RenderTarget->InitAutoFormat(128, 128);
+	RenderTarget->UpdateResourceImmediate(true);
+
+	ReadbackQueue = new FThumbnailReadbackQueue();
+	Cache = new FThumbnailCache();
+	CaptureScheduler = new FThumbnailCaptureScheduler();
+	RequestPool = new FThumbnailRequestPool();
+	TimelineLog = MakeShared<FThumbnailTimelineLog, ESPMode::ThreadSafe>();
+
+	MemoryTrimDelegateHandle = FCoreDelegates::GetMemoryTrimDelegate().AddUObject(this, &UThumbnailEngineSubsystem::TrimUnreferencedThumbnails);
+#if WITH_EDITOR
+	// Fired by reimports and material editor applies too, both finish with PostEditChange.
+	ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddUObject(this, &UThumbnailEngineSubsystem::OnObjectPropertyChanged);
+#endif
+	PackageReloadedHandle = FCoreUObjectDelegates::OnPackageReloaded.AddUObject(this, &UThumbnailEngineSubsystem::OnPackageReloaded);
+	ReloadCompleteHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddUObject(this, &UThumbnailEngineSubsystem::OnReloadComplete);
+}
+void UThumbnailEngineSubsystem::Deinitialize()
+{
+	EndThumbnailProcessing(true);
+	FCoreDelegates::GetMemoryTrimDelegate().Remove(MemoryTrimDelegateHandle);
+#if WITH_EDITOR
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(ObjectPropertyChangedHandle);
+#endif
+	FCoreUObjectDelegates::OnPackageReloaded.Remove(PackageReloadedHandle);
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove(ReloadCompleteHandle);
+	if (Cache)
+	{
+		delete Cache;
+		Cache = nullptr;
+	}
+	FreeRenderTargets.Empty();
+	OutputRenderTargets.Empty();
+	PlaceholderRenderTargets.Empty();
+	if (ReadbackQueue)
+	{
+		// Pending readbacks keep themselves alive on the render thread, flushing lets them finish cleanly.
+		FlushRenderingCommands();
+		delete ReadbackQueue;
+		ReadbackQueue = nullptr;
+	}
+	if (CaptureScheduler)
+	{
+		delete CaptureScheduler;
+		CaptureScheduler = nullptr;
+	}
+	CurrentEntry = nullptr;
+	Queue.Empty();
+	AwaitingReadback.Empty();
+	WaitingForSource.Empty();
+	CompletedPixels->Empty();
+	PendingSubmissions.Empty();
+	CancelledOwners.Empty();
+	if (RequestPool)
+	{
+		delete RequestPool;
+		RequestPool = nullptr;
+	}
+	Super::Deinitialize();
+}
+
+FThumbnailRequest* UThumbnailEngineSubsystem::QueueMeshThumbnail(UStaticMesh* mesh)
+{
+	if (!mesh)
+	{
+		return nullptr;
+	}
+	FThumbnailRequest* newEntry = QueueThumbnail();
+	newEntry->StaticMesh = mesh;
+	return newEntry;
+}
+FThumbnailRequest* UThumbnailEngineSubsystem::QueueMeshThumbnail(USkeletalMesh* mesh)
+{
+	if (!mesh)
+	{
+		return nullptr;
+	}
+	FThumbnailRequest* newEntry = QueueThumbnail();
+	newEntry->SkeletalMesh = mesh;
+	return newEntry;
+}
+FThumbnailRequest* UThumbnailEngineSubsystem::QueueMeshThumbnail(UGeometryCollection* collection)
+{
+	if (!collection)
+	{
+		return nullptr;
+	}
+	FThumbnailRequest* newEntry = QueueThumbnail();
+	newEntry->GeometryCollection = collection;
+	return newEntry;
+}
+FThumbnailRequest* UThumbnailEngineSubsystem::QueueMeshThumbnail(const TArray<FThumbnailPart>& parts)
+{
+	if (!parts.ContainsByPredicate([](const FThumbnailPart& part) { return part.StaticMesh || part.SkeletalMesh; }))
+	{
+		return nullptr;
+	}
+	FThumbnailRequest* newEntry = QueueThumbnail();
+	newEntry->Parts = parts;
+	return newEntry;
+}
+FThumbnailRequest* UThumbnailEngineSubsystem::QueueThumbnail()
+{
+	check(IsInGameThread());
+	FThumbnailRequest* newEntry = RequestPool->Allocate();
+	newEntry->LightingPreset = DefaultLightingPreset;
+	newEntry->QueuedTime = FPlatformTime::Seconds();
+	newEntry->Timeline.Stamp(EThumbnailStage::Queued, newEntry->QueuedTime);
+	Queue.Add(newEntry);
+	StartThumbnailProcessing();
+	return newEntry;
+}
+void UThumbnailEngineSubsystem::SubmitThumbnail(FThumbnailSubmission&& submission)
+{
+	if (!submission.Asset && submission.Parts.IsEmpty())
+	{
+		return;
+	}
+	auto keepAlive = [&submission](UObject* object)
+	{
+		if (object)
+		{
+			submission.ReferencedObjects.Emplace(object);
+		}
+	};
+	for (const FThumbnailPart& part : submission.Parts)
+	{
+		keepAlive(part.StaticMesh.Get());
+		keepAlive(part.SkeletalMesh.Get());
+	}
+	for (const FThumbnailMaterialOverride& materialOverride : submission.MaterialOverrides)
+	{
+		keepAlive(materialOverride.Material.Get());
+	}
+	submission.SubmittedTime = FPlatformTime::Seconds();
+	PendingSubmissions.Enqueue(MoveTemp(submission));
+	StartThumbnailProcessing();
+}
+void UThumbnailEngineSubsystem::DrainSubmissions()
+{
+	while (!PendingSubmissions.IsEmpty())
+	{
+		FThumbnailSubmission submission;
+		PendingSubmissions.Dequeue(submission);
+		if (submission.Owner != FObjectKey() && (!submission.Owner.ResolveObjectPtr() || CancelledOwners.Contains(submission.Owner)))
+		{
+			continue;
+		}
+
+		FThumbnailRequest* entry = nullptr;
+		UObject* asset = submission.Asset.Get();
+		if (submission.Parts.Num() > 0)
+		{
+			entry = QueueMeshThumbnail(submission.Parts);
+		}
+		else if (UStaticMesh* staticMesh = Cast<UStaticMesh>(asset))
+		{
+			entry = QueueMeshThumbnail(staticMesh);
+		}
+		else if (USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(asset))
+		{
+			entry = QueueMeshThumbnail(skeletalMesh);
+		}
+		else if (UGeometryCollection* collection = Cast<UGeometryCollection>(asset))
+		{
+			entry = QueueMeshThumbnail(collection);
+		}
+		if (!entry)
+		{
+			continue;
+		}
+		entry->SizeX = submission.SizeX;
+		entry->SizeY = submission.SizeY;
+		entry->OutputMode = submission.OutputMode;
+		entry->QualityProfile = submission.QualityProfile;
+		entry->CallbackThread = submission.CallbackThread;
+		entry->Owner = submission.Owner;
+		entry->Priority = submission.Priority;
+		entry->bProgressive = submission.bProgressive;
+		if (submission.LightingPreset)
+		{
+			entry->LightingPreset = submission.LightingPreset.Get();
+		}
+		entry->OnComplete = MoveTemp(submission.OnComplete);
+		entry->OnHandleComplete = MoveTemp(submission.OnHandleComplete);
+		entry->OnRenderTargetComplete = MoveTemp(submission.OnRenderTargetComplete);
+		entry->PixelRequest = submission.PixelRequest;
+		entry->OnPixelsComplete = MoveTemp(submission.OnPixelsComplete);
+		entry->PostProcess = submission.PostProcess;
+		entry->MaterialOverrides = MoveTemp(submission.MaterialOverrides);
+		entry->QueuedTime = submission.SubmittedTime;
+		entry->Timeline.Stamp(EThumbnailStage::Queued, submission.SubmittedTime);
+	}
+	// Once the owner is gone the check above drops its submissions anyway.
+	for (auto it = CancelledOwners.CreateIterator(); it; ++it)
+	{
+		if (!it->ResolveObjectPtr())
+		{
+			it.RemoveCurrent();
+		}
+	}
+}
+// Entries being captured or read back cannot be pulled out, they finish into the cache without calling anyone.
+static void UnbindCallbacks(FThumbnailRequest* entry)
+{
+	entry->OnComplete.Unbind();
+	entry->OnHandleComplete.Unbind();
+	entry->OnRenderTargetComplete.Unbind();
+	entry->OnPixelsComplete.Unbind();
+}
+void UThumbnailEngineSubsystem::CancelRequest(const FThumbnailRequestHandle& handle)
+{
+	FThumbnailRequest* entry = RequestPool ? RequestPool->Get(handle) : nullptr;
+	if (!entry)
+	{
+		return;
+	}
+	if (Queue.Remove(entry) > 0 || WaitingForSource.Remove(entry) > 0)
+	{
+		RequestPool->Free(entry);
+		return;
+	}
+	UnbindCallbacks(entry);
+}
+void UThumbnailEngineSubsystem::CancelRequests(FObjectKey owner)
+{
+	auto freeOwned = [this, owner](TArray<FThumbnailRequest*>& entries)
+	{
+		for (int32 i = entries.Num() - 1; i >= 0; i--)
+		{
+			if (entries[i]->Owner == owner)
+			{
+				RequestPool->Free(entries[i]);
+				entries.RemoveAt(i);
+			}
+		}
+	};
+	freeOwned(Queue);
+	freeOwned(WaitingForSource);
+	// Submissions still in flight are left in their queue and skipped when the tick picks them up.
+	CancelledOwners.Add(owner);
+	if (CurrentEntry && CurrentEntry->Owner == owner)
+	{
+		UnbindCallbacks(CurrentEntry);
+	}
+	for (FThumbnailRequest* entry : AwaitingReadback)
+	{
+		if (entry->Owner == owner)
+		{
+			UnbindCallbacks(entry);
+		}
+	}
+}
+bool UThumbnailEngineSubsystem::ThumbnailTick(float DeltaTime)
+{
+
+	if (!PreviewScene)
+	{
+		PreviewScene = new FThumbnailScene();
+		PreviewScene->SetRenderTarget(RenderTarget);
+		PreviewScene->GetRenderActor()->SetProjection(ECameraProjectionMode::Orthographic);
+		// Assets may have been reloaded while the pipeline was idle. Cheap next to creating the preview world.
+		ValidateCache();
+	}
+
+	DrainSubmissions();
+	ReadbackQueue->Tick();
+	DrainCompletedPixels();
+
+	const int32 maxCaptures = FMath::Max(CVarThumbnailMaxCapturesPerTick.GetValueOnGameThread(), 1);
+	int32 numCaptures = 0;
+	if (!CurrentEntry)
+	{
+		numCaptures += RenderPlaceholders(maxCaptures);
+	}
+
+	while (numCaptures < maxCaptures && CaptureScheduler->CanSubmit())
+	{
+		if (!CurrentEntry)
+		{
+			if (Queue.IsEmpty())
+			{
+				if (ReadbackQueue->IsEmpty() && AwaitingReadback.IsEmpty() && WaitingForSource.IsEmpty())
+				{
+					EndThumbnailProcessing();
+				}
+				return true;
+			}
+			CurrentEntry = PopNextEntry();
+		}
+		switch (CurrentEntry->State)
+		{
+		case EJPBThumbnailRenderState::ThumbnailRenderState_Init:
+			DoInitState();
+			break;
+		case EJPBThumbnailRenderState::ThumbnailRenderState_Processing:
+			CaptureScheduler->Submit(*PreviewScene);
+			numCaptures++;
+			DoProcessingState();
+			break;
+		case EJPBThumbnailRenderState::ThumbnailRenderState_Completed:
+			DoCompletedState();
+			break;
+		}
+	}
+
+	return true;
+}
+
+void UThumbnailEngineSubsystem::DoInitState()
+{
+	check(CurrentEntry);
+	FThumbnailTimeline& timeline = CurrentEntry->Timeline;
+	// Entries resumed after waiting for a larger render keep their first Init, the wait shows up as Coalesced.
+	if (timeline.Get(EThumbnailStage::Init) == 0.0)
+	{
+		const UObject* asset = CurrentEntry->GetAsset();
+		timeline.Stamp(EThumbnailStage::Init);
+		timeline.Asset = asset ? asset->GetFName() : NAME_None;
+		timeline.AssetType = CurrentEntry->Parts.Num() > 0 ? FName(TEXT("Composite")) : asset ? asset->GetClass()->GetFName() : NAME_None;
+		timeline.SizeX = CurrentEntry->SizeX;
+		timeline.SizeY = CurrentEntry->SizeY;
+		timeline.OutputMode = CurrentEntry->OutputMode;
+	}
+	if (CurrentEntry->OutputMode == EThumbnailOutputMode::Texture2D)
+	{
+		if (TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> record = Cache->Find(CurrentEntry->GetCacheKey()))
+		{
+			CompleteFromCache(record);
+			return;
+		}
+		if (CVarThumbnailDownsampleFromCache.GetValueOnGameThread())
+		{
+			if (TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> source = Cache->FindDownsampleSource(CurrentEntry->GetCacheKey()))
+			{
+				EnqueueDownsample(source);
+				return;
+			}
+			if (WaitForLargerRender())
+			{
+				return;
+			}
+		}
+	}
+	CurrentEntry->GatherDependencies();
+	const FThumbnailCacheKey key = CurrentEntry->GetCacheKey();
+	const bool bVariant = key.IsVariantOf(SceneKey);
+	if (!bVariant)
+	{
+		const double sizeX = CurrentEntry->SizeX;
+		const double sizeY = CurrentEntry->SizeY;
+
+		if (sizeX != RenderTargetSize.X || sizeY != RenderTargetSize.Y)
+		{
+			RenderTargetSize.X = sizeX;
+			RenderTargetSize.Y = sizeY;
+			RenderTarget->ResizeTarget(sizeX, sizeY);
+			RenderTarget->UpdateResourceImmediate(true);
+		}
+		SetPreviewAsset(CurrentEntry);
+
+		PreviewScene->SetQualityProfile(CurrentEntry->QualityProfile);
+		// Both only dirty the lighting when it changes, as does reframing a different mesh above.
+		PreviewScene->SetLightingPreset(CurrentEntry->LightingPreset);
+	}
+	PreviewScene->SetMaterialOverrides(CurrentEntry->MaterialOverrides);
+	PreviewScene->SetRenderDirty();
+	SceneKey = key;
+	SceneDependencies = CurrentEntry->Dependencies;
+	timeline.Stamp(EThumbnailStage::Loaded);
+	CurrentEntry->State = EJPBThumbnailRenderState::ThumbnailRenderState_Processing;
+	CurrentEntry->ProcessingCount = bVariant ? ThumbnailQuality::GetVariantSettleFrames(CurrentEntry->QualityProfile)
+		: ThumbnailQuality::GetSettleFrames(CurrentEntry->QualityProfile);
+}
+void UThumbnailEngineSubsystem::SetPreviewAsset(const FThumbnailRequest* entry)
+{
+	if (UStaticMesh* staticMesh = entry->StaticMesh)
+	{
+		PreviewScene->SetStaticMesh(staticMesh);
+	}
+	else if (USkeletalMesh* skeletalMesh = entry->SkeletalMesh)
+	{
+		PreviewScene->SetSkeletalMesh(skeletalMesh);
+	}
+	else if (UGeometryCollection* collection = entry->GeometryCollection)
+	{
+		PreviewScene->SetGeometryCollection(collection);
+	}
+	else if (entry->Parts.Num() > 0)
+	{
+		PreviewScene->SetComposite(entry->Parts);
+	}
+}
+FThumbnailRequest* UThumbnailEngineSubsystem::PopNextEntry()
+{
+	int32 bestIndex = Queue.Num() - 1;
+	for (int32 i = bestIndex - 1; i >= 0; i--)
+	{
+		if (Queue[i]->Priority > Queue[bestIndex]->Priority)
+		{
+			bestIndex = i;
+		}
+	}
+	FThumbnailRequest* entry = Queue[bestIndex];
+	Queue.RemoveAt(bestIndex);
+	return entry;
+}
+int32 UThumbnailEngineSubsystem::RenderPlaceholders(int32 maxCaptures)
+{
+	const int32 maxPlaceholders = FMath::Min(CVarThumbnailPlaceholdersPerTick.GetValueOnGameThread(), maxCaptures);
+	if (maxPlaceholders <= 0 || !CaptureScheduler->CanSubmit())
+	{
+		return 0;
+	}
+	TArray<FThumbnailRequest*> candidates;
+	for (int32 i = Queue.Num() - 1; i >= 0; i--)
+	{
+		FThumbnailRequest* entry = Queue[i];
+		if (entry->bProgressive && !entry->bPlaceholderQueued && entry->State == EJPBThumbnailRenderState::ThumbnailRenderState_Init
+			&& entry->OutputMode == EThumbnailOutputMode::Texture2D)
+		{
+			candidates.Add(entry);
+		}
+	}
+	if (candidates.IsEmpty())
+	{
+		return 0;
+	}
+	// Gathered newest first, a stable sort keeps the same order PopNextEntry will use for the full renders.
+	candidates.StableSort([](const FThumbnailRequest& a, const FThumbnailRequest& b) { return a.Priority > b.Priority; });
+
+	const int32 placeholderSize = FMath::Clamp(CVarThumbnailPlaceholderSize.GetValueOnGameThread(), 8, 256);
+	const EThumbnailQualityProfile previousProfile = PreviewScene->GetRenderActor()->GetQualityProfile();
+	UThumbnailLightingPreset* previousPreset = PreviewScene->GetLightingPreset();
+	PreviewScene->SetQualityProfile(EThumbnailQualityProfile::Fast);
+
+	int32 numPlaceholders = 0;
+	for (FThumbnailRequest* entry : candidates)
+	{
+		if (numPlaceholders >= maxPlaceholders || !CaptureScheduler->CanSubmit())
+		{
+			break;
+		}
+		entry->bPlaceholderQueued = true;
+		if (Cache->Find(entry->GetCacheKey()))
+		{
+			// The full thumbnail is served as soon as the entry is popped, a placeholder would only be slower.
+			continue;
+		}
+		const float scale = (float)placeholderSize / FMath::Max(entry->SizeX, entry->SizeY);
+		const FIntPoint size(FMath::Max(FMath::RoundToInt(entry->SizeX * scale), 1), FMath::Max(FMath::RoundToInt(entry->SizeY * scale), 1));
+		TObjectPtr<UTextureRenderTarget2D>& target = PlaceholderRenderTargets.FindOrAdd(size);
+		if (!target)
+		{
+			target = NewObject<UTextureRenderTarget2D>(GetTransientPackage(), NAME_None, RF_Transient);
+			target->RenderTargetFormat = RenderTarget->RenderTargetFormat;
+			target->ClearColor = FLinearColor::Transparent;
+			target->InitAutoFormat(size.X, size.Y);
+			target->UpdateResourceImmediate(true);
+		}
+
+		SetPreviewAsset(entry);
+		PreviewScene->SetLightingPreset(entry->LightingPreset);
+		PreviewScene->SetMaterialOverrides(entry->MaterialOverrides);
+		entry->GatherDependencies();
+		SceneDependencies.Append(entry->Dependencies);
+		PreviewScene->SetRenderTarget(target);
+		// Fast captures are final after one frame. Render commands run in order, so the readback copies this capture
+		// before the next placeholder draws into a shared target.
+		CaptureScheduler->Submit(*PreviewScene);
+		EnqueueTextureReadback(entry, target, true);
+		numPlaceholders++;
+	}
+	PreviewScene->SetRenderTarget(RenderTarget);
+	PreviewScene->SetQualityProfile(previousProfile);
+	PreviewScene->SetLightingPreset(previousPreset);
+	if (numPlaceholders > 0)
+	{
+		// The mesh shown no longer matches, the next entry has to load and settle in full.
+		SceneKey = FThumbnailCacheKey();
+		CaptureScheduler->FenceOutstandingWork();
+	}
+	return numPlaceholders;
+}
+void UThumbnailEngineSubsystem::DoProcessingState()
+{
+	if (!CurrentEntry)
+	{
+		return;
+	}
+	int32& ProcessingCount = CurrentEntry->ProcessingCount;
+	ProcessingCount--;
+	if (ProcessingCount <= 0)
+	{
+		CurrentEntry->State = EJPBThumbnailRenderState::ThumbnailRenderState_Completed;
+		CurrentEntry->Timeline.Stamp(EThumbnailStage::Settled);
+		switch (CurrentEntry->OutputMode)
+		{
+		case EThumbnailOutputMode::Texture2D:
+			EnqueueTextureReadback(CurrentEntry, RenderTarget);
+			break;
+		case EThumbnailOutputMode::RenderTarget:
+			RecordFinal(CurrentEntry);
+			if (CurrentEntry->CallbackThread == EThumbnailCallbackThread::AnyThread)
+			{
+				UE::Tasks::Launch(UE_SOURCE_LOCATION, [onComplete = MoveTemp(CurrentEntry->OnRenderTargetComplete), target = CopyToPooledRenderTarget(),
+					timeline = CurrentEntry->Timeline, timelineLog = TimelineLog.ToSharedRef()]() mutable
+				{
+					onComplete.ExecuteIfBound(target);
+					FinishTimeline(timeline, *timelineLog);
+				});
+			}
+			else
+			{
+				CurrentEntry->OnRenderTargetComplete.ExecuteIfBound(CopyToPooledRenderTarget());
+				FinishTimeline(CurrentEntry->Timeline, *TimelineLog);
+			}
+			break;
+		case EThumbnailOutputMode::Pixels:
+		{
+			// Outlives the entry, which is freed below while the readback is still in flight.
+			TSharedRef<FThumbnailTimeline, ESPMode::ThreadSafe> timeline = MakeShared<FThumbnailTimeline, ESPMode::ThreadSafe>(CurrentEntry->Timeline);
+			FOnThumbnailPixels onDelivered = FOnThumbnailPixels::CreateLambda([timeline, timelineLog = TimelineLog.ToSharedRef(), onComplete = MoveTemp(CurrentEntry->OnPixelsComplete)](const FThumbnailPixels& pixels)
+			{
+				onComplete.ExecuteIfBound(pixels);
+				FinishTimeline(*timeline, *timelineLog);
+			});
+			if (CurrentEntry->CallbackThread == EThumbnailCallbackThread::GameThread)
+			{
+				onDelivered = MarshalToGameThread(MoveTemp(onDelivered));
+			}
+			ReadbackQueue->Enqueue(RenderTarget, CurrentEntry->PixelRequest, FOnThumbnailPixels::CreateLambda([timeline, onDelivered = MoveTemp(onDelivered)](const FThumbnailPixels& pixels)
+			{
+				timeline->Stamp(EThumbnailStage::Captured, pixels.CapturedTime);
+				timeline->Stamp(EThumbnailStage::ReadBack);
+				onDelivered.ExecuteIfBound(pixels);
+			}), CurrentEntry->PostProcess);
+			break;
+		}
+		}
+		// The copy or readback above must land before the next entry starts drawing into the same target.
+		CaptureScheduler->FenceOutstandingWork();
+		if (CurrentEntry->OutputMode != EThumbnailOutputMode::Texture2D)
+		{
+			RequestPool->Free(CurrentEntry);
+		}
+		CurrentEntry = nullptr;
+	}
+}
+void UThumbnailEngineSubsystem::EnqueueTextureReadback(FThumbnailRequest* entry, UTextureRenderTarget2D* target, bool bPlaceholder)
+{
+	if (!bPlaceholder)
+	{
+		AwaitingReadback.Add(entry);
+	}
+
+	FThumbnailPixelRequest request;
+	request.Format = EThumbnailPixelFormat::RGBA16F;
+
+	FThumbnailRequestHandle entryHandle = entry->Handle;
+	TSharedRef<TQueue<FThumbnailCompletedPixels, EQueueMode::Mpsc>, ESPMode::ThreadSafe> completedPixels = CompletedPixels;
+	ReadbackQueue->Enqueue(target, request, FOnThumbnailPixels::CreateLambda([entryHandle, completedPixels, bPlaceholder](const FThumbnailPixels& pixels)
+	{
+		FThumbnailCompletedPixels completed;
+		completed.Entry = entryHandle;
+		completed.bPlaceholder = bPlaceholder;
+		completed.SizeX = pixels.SizeX;
+		completed.SizeY = pixels.SizeY;
+		completed.Pixels.Append(pixels.Pixels.GetData(), pixels.Pixels.Num());
+		completed.CapturedTime = pixels.CapturedTime;
+		if (!bPlaceholder)
+		{
+			completed.Hash.Exact = ThumbnailImageHash::Exact(completed.Pixels.GetData(), completed.Pixels.Num(), completed.SizeX, completed.SizeY);
+			completed.Hash.Perceptual = ThumbnailImageHash::Perceptual(reinterpret_cast<const FFloat16Color*>(completed.Pixels.GetData()), completed.SizeX, completed.SizeY);
+		}
+		completedPixels->Enqueue(MoveTemp(completed));
+	}), entry->PostProcess);
+}
+void UThumbnailEngineSubsystem::DrainCompletedPixels()
+{
+	FThumbnailCompletedPixels completed;
+	while (CompletedPixels->Dequeue(completed))
+	{
+		FThumbnailRequest* entry = RequestPool->Get(completed.Entry);
+		if (!entry)
+		{
+			continue;
+		}
+		if (completed.bPlaceholder)
+		{
+			// Not cached and not pinned, the full render replaces it through the same delegate shortly.
+			UTexture2D* placeholder = CreateThumbnailTexture(completed.SizeX, completed.SizeY, completed.Pixels.GetData());
+			entry->bPlaceholderDelivered = true;
+			LatencyStats.Placeholders++;
+			RecordFirstIcon(entry);
+			if (entry->CallbackThread == EThumbnailCallbackThread::AnyThread)
+			{
+				UE::Tasks::Launch(UE_SOURCE_LOCATION, [onComplete = entry->OnComplete, placeholder = TStrongObjectPtr<UTexture2D>(placeholder)]()
+				{
+					onComplete.ExecuteIfBound(placeholder.Get());
+				});
+			}
+			else
+			{
+				entry->OnComplete.ExecuteIfBound(placeholder);
+			}
+			continue;
+		}
+		AwaitingReadback.Remove(entry);
+		if (entry->bDependencyChanged)
+		{
+			// Captured from the asset as it was before the change, render it again instead.
+			entry->bDependencyChanged = false;
+			entry->State = EJPBThumbnailRenderState::ThumbnailRenderState_Init;
+			Queue.Add(entry);
+			continue;
+		}
+		if (completed.CapturedTime > 0.0)
+		{
+			entry->Timeline.Stamp(EThumbnailStage::Captured, completed.CapturedTime);
+		}
+		entry->Timeline.Stamp(EThumbnailStage::ReadBack);
+
+		// Identical pixels from another asset or variant share the texture already built for them.
+		UTexture2D* texture = Cast<UTexture2D>(Cache->FindIdentical(completed.Hash.Exact));
+		if (!texture)
+		{
+			texture = CreateThumbnailTexture(completed.SizeX, completed.SizeY, completed.Pixels.GetData());
+		}
+		const int64 bytes = CalculateImageBytes(completed.SizeX, completed.SizeY, 0, PF_FloatRGBA);
+		TSharedPtr<const TArray64<uint8>, ESPMode::ThreadSafe> pixels;
+		// Trimmed results no longer match their key's size, so nothing can be downsampled from them.
+		if (CVarThumbnailDownsampleFromCache.GetValueOnGameThread() && completed.SizeX == entry->SizeX && completed.SizeY == entry->SizeY)
+		{
+			pixels = MakeShared<TArray64<uint8>, ESPMode::ThreadSafe>(MoveTemp(completed.Pixels));
+		}
+		TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> record = Cache->Add(entry->GetCacheKey(), texture, bytes, pixels, MoveTemp(entry->Dependencies), completed.Hash);
+		DeliverTexture(entry, FThumbnailHandle(record));
+		EnforceMemoryBudget();
+
+		const UObject* asset = entry->GetAsset();
+		RequestPool->Free(entry);
+		ResumeWaitingForSource(asset);
+	}
+	ResumeWaitingWithoutSource();
+}
+void UThumbnailEngineSubsystem::EnqueueDownsample(const TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>& source)
+{
+	Cache->RecordDownsampleHit();
+	CurrentEntry->State = EJPBThumbnailRenderState::ThumbnailRenderState_Completed;
+	CurrentEntry->Timeline.Source = EThumbnailResultSource::Downsampled;
+	CurrentEntry->Timeline.Stamp(EThumbnailStage::Coalesced);
+	// Same render at another size, so it depends on exactly what the source does.
+	CurrentEntry->Dependencies = source->Dependencies;
+	AwaitingReadback.Add(CurrentEntry);
+
+	FThumbnailRequestHandle entryHandle = CurrentEntry->Handle;
+	TSharedRef<TQueue<FThumbnailCompletedPixels, EQueueMode::Mpsc>, ESPMode::ThreadSafe> completedPixels = CompletedPixels;
+	TSharedPtr<const TArray64<uint8>, ESPMode::ThreadSafe> sourcePixels = source->Pixels;
+	const int32 sourceX = source->Key.SizeX;
+	const int32 sourceY = source->Key.SizeY;
+	const int32 destX = CurrentEntry->SizeX;
+	const int32 destY = CurrentEntry->SizeY;
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [entryHandle, completedPixels, sourcePixels, sourceX, sourceY, destX, destY]()
+	{
+		FThumbnailCompletedPixels completed;
+		completed.Entry = entryHandle;
+		completed.SizeX = destX;
+		completed.SizeY = destY;
+		completed.Pixels.SetNumUninitialized((int64)destX * destY * sizeof(FFloat16Color));
+		ThumbnailDownsample::Downsample(reinterpret_cast<const FFloat16Color*>(sourcePixels->GetData()), sourceX, sourceY,
+			reinterpret_cast<FFloat16Color*>(completed.Pixels.GetData()), destX, destY);
+		completed.Hash.Exact = ThumbnailImageHash::Exact(completed.Pixels.GetData(), completed.Pixels.Num(), destX, destY);
+		completed.Hash.Perceptual = ThumbnailImageHash::Perceptual(reinterpret_cast<const FFloat16Color*>(completed.Pixels.GetData()), destX, destY);
+		completedPixels->Enqueue(MoveTemp(completed));
+	});
+
+	CurrentEntry = nullptr;
+}
+bool UThumbnailEngineSubsystem::CanDownsampleFrom(const FThumbnailRequest* source, const FThumbnailRequest* dest) const
+{
+	if (source == dest || source->OutputMode != EThumbnailOutputMode::Texture2D || source->PostProcess.bTrimTransparentBorder
+		|| !source->GetCacheKey().IsSameRender(dest->GetCacheKey()))
+	{
+		return false;
+	}
+	// An identical request counts too, it is served from the cache once the source lands.
+	return ThumbnailDownsample::CanDownsample(source->SizeX, source->SizeY, dest->SizeX, dest->SizeY);
+}
+bool UThumbnailEngineSubsystem::WaitForLargerRender()
+{
+	bool bSourcePending = AwaitingReadback.ContainsByPredicate([this](const FThumbnailRequest* other) { return CanDownsampleFrom(other, CurrentEntry); });
+	if (!bSourcePending)
+	{
+		int32 largestIndex = INDEX_NONE;
+		for (int32 i = 0; i < Queue.Num(); i++)
+		{
+			if (CanDownsampleFrom(Queue[i], CurrentEntry) && (largestIndex == INDEX_NONE || Queue[i]->SizeX > Queue[largestIndex]->SizeX))
+			{
+				largestIndex = i;
+			}
+		}
+		if (largestIndex != INDEX_NONE)
+		{
+			// Queue is consumed from the back, move the larger or identical render there so it goes next.
+			FThumbnailRequest* larger = Queue[largestIndex];
+			Queue.RemoveAt(largestIndex);
+			Queue.Add(larger);
+			larger->Priority = FMath::Max(larger->Priority, CurrentEntry->Priority);
+			bSourcePending = true;
+		}
+	}
+	if (!bSourcePending)
+	{
+		return false;
+	}
+	CurrentEntry->Timeline.Stamp(EThumbnailStage::Coalesced);
+	WaitingForSource.Add(CurrentEntry);
+	CurrentEntry = nullptr;
+	return true;
+}
+void UThumbnailEngineSubsystem::ResumeWaitingForSource(const UObject* asset)
+{
+	for (int32 i = WaitingForSource.Num() - 1; i >= 0; i--)
+	{
+		if (!asset || WaitingForSource[i]->GetAsset() == asset)
+		{
+			Queue.Add(WaitingForSource[i]);
+			WaitingForSource.RemoveAt(i);
+		}
+	}
+}
+void UThumbnailEngineSubsystem::ResumeWaitingWithoutSource()
+{
+	// Sources that failed, were cancelled or were requeued as a different render no longer cover their waiters.
+	for (int32 i = WaitingForSource.Num() - 1; i >= 0; i--)
+	{
+		FThumbnailRequest* waiting = WaitingForSource[i];
+		auto isSource = [this, waiting](const FThumbnailRequest* other) { return CanDownsampleFrom(other, waiting); };
+		if (!AwaitingReadback.ContainsByPredicate(isSource) && !Queue.ContainsByPredicate(isSource) && !(CurrentEntry && isSource(CurrentEntry)))
+		{
+			Queue.Add(waiting);
+			WaitingForSource.RemoveAt(i);
+		}
+	}
+}
+UTexture2D* UThumbnailEngineSubsystem::CreateThumbnailTexture(int32 sizeX, int32 sizeY, const uint8* float16Pixels)
+{
+	UTexture2D* texture = UTexture2D::CreateTransient(sizeX, sizeY, PF_FloatRGBA, MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass()));
+	texture->SRGB = false;
+
+	FTexture2DMipMap& mip = texture->GetPlatformData()->Mips[0];
+	void* mipData = mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(mipData, float16Pixels, (int64)sizeX * sizeY * sizeof(FFloat16Color));
+	mip.BulkData.Unlock();
+
+	texture->UpdateResource();
+	return texture;
+}
+UTextureRenderTarget2D* UThumbnailEngineSubsystem::CopyToPooledRenderTarget()
+{
+	UTextureRenderTarget2D* target = AcquireRenderTarget(RenderTarget->SizeX, RenderTarget->SizeY);
+
+	FTextureRenderTargetResource* sourceResource = RenderTarget->GameThread_GetRenderTargetResource();
+	FTextureRenderTargetResource* destResource = target->GameThread_GetRenderTargetResource();
+	ENQUEUE_RENDER_COMMAND(CopyThumbnailRenderTarget)([sourceResource, destResource](FRHICommandListImmediate& RHICmdList)
+	{
+		FRHITexture* sourceTexture = sourceResource->GetRenderTargetTexture();
+		FRHITexture* destTexture = destResource->GetRenderTargetTexture();
+		if (!sourceTexture || !destTexture)
+		{
+			return;
+		}
+		RHICmdList.Transition({
+			FRHITransitionInfo(sourceTexture, ERHIAccess::Unknown, ERHIAccess::CopySrc),
+			FRHITransitionInfo(destTexture, ERHIAccess::Unknown, ERHIAccess::CopyDest) });
+		RHICmdList.CopyTexture(sourceTexture, destTexture, FRHICopyTextureInfo());
+		RHICmdList.Transition({
+			FRHITransitionInfo(sourceTexture, ERHIAccess::CopySrc, ERHIAccess::SRVMask),
+			FRHITransitionInfo(destTexture, ERHIAccess::CopyDest, ERHIAccess::SRVMask) });
+	});
+	return target;
+}
+UTextureRenderTarget2D* UThumbnailEngineSubsystem::AcquireRenderTarget(int32 sizeX, int32 sizeY)
+{
+	for (int32 i = 0; i < FreeRenderTargets.Num(); i++)
+	{
+		UTextureRenderTarget2D* pooled = FreeRenderTargets[i];
+		if (pooled && pooled->SizeX == sizeX && pooled->SizeY == sizeY)
+		{
+			FreeRenderTargets.RemoveAtSwap(i);
+			return pooled;
+		}
+	}
+
+	UTextureRenderTarget2D* newTarget = NewObject<UTextureRenderTarget2D>(GetTransientPackage(), NAME_None, RF_Transient);
+	newTarget->RenderTargetFormat = RenderTarget->RenderTargetFormat;
+	newTarget->ClearColor = FLinearColor::Transparent;
+	newTarget->InitAutoFormat(sizeX, sizeY);
+	newTarget->UpdateResourceImmediate(true);
+	OutputRenderTargets.Add(newTarget);
+	EnforceMemoryBudget();
+	return newTarget;
+}
+void UThumbnailEngineSubsystem::ReleaseRenderTarget(UTextureRenderTarget2D* renderTarget)
+{
+	if (!renderTarget || !OutputRenderTargets.Contains(renderTarget))
+	{
+		return;
+	}
+	FreeRenderTargets.AddUnique(renderTarget);
+}
+void UThumbnailEngineSubsystem::CompleteFromCache(const TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>& record)
+{
+	FThumbnailHandle handle(record);
+	Cache->RecordHit();
+	CurrentEntry->State = EJPBThumbnailRenderState::ThumbnailRenderState_Completed;
+	CurrentEntry->Timeline.Source = EThumbnailResultSource::Cache;
+	CurrentEntry->Timeline.Stamp(EThumbnailStage::Coalesced);
+	DeliverTexture(CurrentEntry, handle);
+	RequestPool->Free(CurrentEntry);
+	CurrentEntry = nullptr;
+}
+void UThumbnailEngineSubsystem::DeliverTexture(FThumbnailRequest* entry, const FThumbnailHandle& handle)
+{
+	RecordFinal(entry);
+	UTexture2D* texture = Cast<UTexture2D>(handle.GetTexture());
+	if (entry->CallbackThread != EThumbnailCallbackThread::AnyThread)
+	{
+		entry->OnComplete.ExecuteIfBound(texture);
+		entry->OnHandleComplete.ExecuteIfBound(handle);
+		FinishTimeline(entry->Timeline, *TimelineLog);
+		return;
+	}
+	// The captured handle pins the texture until the worker is done with it.
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [onComplete = MoveTemp(entry->OnComplete), onHandleComplete = MoveTemp(entry->OnHandleComplete), texture, handle,
+		timeline = entry->Timeline, timelineLog = TimelineLog.ToSharedRef()]() mutable
+	{
+		onComplete.ExecuteIfBound(texture);
+		onHandleComplete.ExecuteIfBound(handle);
+		FinishTimeline(timeline, *timelineLog);
+	});
+}
+FThumbnailHandle UThumbnailEngineSubsystem::PinThumbnail(UTexture2D* texture)
+{
+	return Cache && texture ? Cache->FindByTexture(texture) : FThumbnailHandle();
+}
+int64 UThumbnailEngineSubsystem::GetRenderTargetBytes(UTextureRenderTarget2D* target) const
+{
+	return target ? CalculateImageBytes(target->SizeX, target->SizeY, 0, target->GetFormat()) : 0;
+}
+FThumbnailMemoryStats UThumbnailEngineSubsystem::GetMemoryStats() const
+{
+	FThumbnailMemoryStats stats;
+	stats.BudgetBytes = (int64)CVarThumbnailMemoryBudgetMB.GetValueOnGameThread() * 1024 * 1024;
+	if (Cache)
+	{
+		Cache->AccumulateStats(stats);
+	}
+	for (UTextureRenderTarget2D* target : OutputRenderTargets)
+	{
+		stats.TotalBytes += GetRenderTargetBytes(target);
+		stats.Count++;
+		if (!FreeRenderTargets.Contains(target))
+		{
+			stats.ReferencedCount++;
+		}
+	}
+	return stats;
+}
+FThumbnailLatencyStats UThumbnailEngineSubsystem::GetLatencyStats() const
+{
+	FThumbnailLatencyStats stats = LatencyStats;
+	stats.AverageTimeToFirstIcon = NumFirstIcons > 0 ? TotalTimeToFirstIcon / NumFirstIcons : 0.f;
+	stats.AverageTimeToFinal = stats.Completed > 0 ? TotalTimeToFinal / stats.Completed : 0.f;
+	return stats;
+}
+void UThumbnailEngineSubsystem::RecordFirstIcon(FThumbnailRequest* entry)
+{
+	const double elapsed = FPlatformTime::Seconds() - entry->QueuedTime;
+	NumFirstIcons++;
+	TotalTimeToFirstIcon += elapsed;
+	LatencyStats.MaxTimeToFirstIcon = FMath::Max(LatencyStats.MaxTimeToFirstIcon, (float)elapsed);
+}
+void UThumbnailEngineSubsystem::RecordFinal(FThumbnailRequest* entry)
+{
+	if (!entry->bPlaceholderDelivered)
+	{
+		RecordFirstIcon(entry);
+	}
+	const double elapsed = FPlatformTime::Seconds() - entry->QueuedTime;
+	LatencyStats.Completed++;
+	TotalTimeToFinal += elapsed;
+	LatencyStats.MaxTimeToFinal = FMath::Max(LatencyStats.MaxTimeToFinal, (float)elapsed);
+}
+void UThumbnailEngineSubsystem::FinishTimeline(FThumbnailTimeline& timeline, FThumbnailTimelineLog& log)
+{
+	timeline.Stamp(EThumbnailStage::Delivered);
+	log.Add(timeline);
+}
+void UThumbnailEngineSubsystem::DumpTimelines(int32 numRecent) const
+{
+	if (TimelineLog)
+	{
+		TimelineLog->Dump(numRecent);
+	}
+}
+void UThumbnailEngineSubsystem::SetDefaultLightingPreset(UThumbnailLightingPreset* preset)
+{
+	DefaultLightingPreset = preset;
+}
+void UThumbnailEngineSubsystem::EnforceMemoryBudget()
+{
+	const int64 budgetBytes = (int64)CVarThumbnailMemoryBudgetMB.GetValueOnGameThread() * 1024 * 1024;
+
+	int64 renderTargetBytes = 0;
+	for (UTextureRenderTarget2D* target : OutputRenderTargets)
+	{
+		renderTargetBytes += GetRenderTargetBytes(target);
+	}
+	// Idle pooled render targets go first, they are cheap to recreate.
+	while (renderTargetBytes > budgetBytes && FreeRenderTargets.Num() > 0)
+	{
+		UTextureRenderTarget2D* target = FreeRenderTargets.Pop();
+		OutputRenderTargets.Remove(target);
+		renderTargetBytes -= GetRenderTargetBytes(target);
+	}
+	Cache->EnforceBudget(FMath::Max<int64>(budgetBytes - renderTargetBytes, 0));
+}
+void UThumbnailEngineSubsystem::TrimUnreferencedThumbnails()
+{
+	for (UTextureRenderTarget2D* target : FreeRenderTargets)
+	{
+		OutputRenderTargets.Remove(target);
+	}
+	FreeRenderTargets.Empty();
+	if (Cache)
+	{
+		Cache->TrimUnreferenced();
+	}
+}
+int32 UThumbnailEngineSubsystem::ValidateCache()
+{
+	if (!Cache)
+	{
+		return 0;
+	}
+	if (PreviewScene && SceneDependencies.ContainsByPredicate([](const FThumbnailDependency& dependency) { return !dependency.IsCurrent(); }))
+	{
+		PreviewScene->ReleasePreviewAssets();
+		SceneKey = FThumbnailCacheKey();
+		SceneDependencies.Reset();
+	}
+	return Cache->ValidateDependencies();
+}
+TArray<FThumbnailDuplicateGroup> UThumbnailEngineSubsystem::GetDuplicateGroups() const
+{
+	return Cache ? Cache->GetDuplicateGroups(CVarThumbnailPerceptualDuplicateDistance.GetValueOnGameThread()) : TArray<FThumbnailDuplicateGroup>();
+}
+bool UThumbnailEngineSubsystem::IsIdle() const
+{
+	return !PreviewScene && !CurrentEntry && Queue.IsEmpty() && AwaitingReadback.IsEmpty() && WaitingForSource.IsEmpty()
+		&& PendingSubmissions.IsEmpty() && CompletedPixels->IsEmpty() && (!ReadbackQueue || ReadbackQueue->IsEmpty());
+}
+int32 UThumbnailEngineSubsystem::GetNumRequestsInUse() const
+{
+	return RequestPool ? RequestPool->GetNumInUse() : 0;
+}
+int32 UThumbnailEngineSubsystem::GetNumCaptures() const
+{
+	return CaptureScheduler ? CaptureScheduler->GetNumSubmitted() : 0;
+}
+void UThumbnailEngineSubsystem::InvalidatePackage(FName packageName)
+{
+	if (!Cache)
+	{
+		return;
+	}
+	Cache->InvalidatePackage(packageName);
+	if (PreviewScene && SceneDependencies.ContainsByPredicate([packageName](const FThumbnailDependency& dependency) { return dependency.PackageName == packageName; }))
+	{
+		PreviewScene->ReleasePreviewAssets();
+		SceneKey = FThumbnailCacheKey();
+		SceneDependencies.Reset();
+		if (CurrentEntry && CurrentEntry->State == EJPBThumbnailRenderState::ThumbnailRenderState_Processing)
+		{
+			// Settle frames drawn so far show the old asset, start over.
+			CurrentEntry->State = EJPBThumbnailRenderState::ThumbnailRenderState_Init;
+		}
+	}
+	for (FThumbnailRequest* entry : AwaitingReadback)
+	{
+		if (entry->DependsOn(packageName))
+		{
+			entry->bDependencyChanged = true;
+		}
+	}
+}
+#if WITH_EDITOR
+void UThumbnailEngineSubsystem::OnObjectPropertyChanged(UObject* object, FPropertyChangedEvent& event)
+{
+	// Interactive changes such as slider drags are followed by a final ValueSet.
+	if (object && event.ChangeType != EPropertyChangeType::Interactive)
+	{
+		InvalidatePackage(object->GetPackage()->GetFName());
+	}
+}
+#endif
+void UThumbnailEngineSubsystem::OnPackageReloaded(EPackageReloadPhase phase, FPackageReloadedEvent* event)
+{
+	if (phase == EPackageReloadPhase::PrePackageFixup && event)
+	{
+		InvalidatePackage(event->GetOldPackage()->GetFName());
+	}
+}
+void UThumbnailEngineSubsystem::OnReloadComplete(EReloadCompleteReason reason)
+{
+	if (Cache && (reason == EReloadCompleteReason::HotReloadManual || reason == EReloadCompleteReason::HotReloadAutomatic))
+	{
+		// Reloaded code can change any render and leaves no package behind to match, so nothing cached is trusted.
+		if (PreviewScene)
+		{
+			PreviewScene->ReleasePreviewAssets();
+		}
+		SceneKey = FThumbnailCacheKey();
+		SceneDependencies.Reset();
+		Cache->Empty();
+		return;
+	}
+	ValidateCache();
+}
+void UThumbnailEngineSubsystem::DoCompletedState()
+{
+	if (CurrentEntry)
+	{
+		RequestPool->Free(CurrentEntry);
+		CurrentEntry = nullptr;
+	}
+}
+void UThumbnailEngineSubsystem::EndThumbnailProcessing(bool bForce)
+{
+	{
+		// Checked under the lock so a submission racing with this either keeps the ticker or restarts it.
+		FScopeLock lock(&TickerMutex);
+		if (!bForce && !PendingSubmissions.IsEmpty())
+		{
+			return;
+		}
+		if (TickDelegateHandle.IsValid())
+		{
+			FTSTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
+			TickDelegateHandle.Reset();
+		}
+	}
+	if (PreviewScene)
+	{
+		delete PreviewScene;
+		PreviewScene = nullptr;
+	}
+	SceneKey = FThumbnailCacheKey();
+	SceneDependencies.Reset();
+}
+void UThumbnailEngineSubsystem::StartThumbnailProcessing()
+{
+	FScopeLock lock(&TickerMutex);
+	if (TickDelegateHandle.IsValid())
+	{
+		return;
+	}
+	TickDelegateHandle = FTSTicker::GetCoreTicker().AddTicker(TickDelegate);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "ThumbnailImageHash.h"
+#include "Hash/CityHash.h"
+
+namespace ThumbnailImageHash
+{
+	uint64 Exact(const uint8* pixels, int64 numBytes, int32 sizeX, int32 sizeY)
+	{
+		const uint64 seed = ((uint64)(uint32)sizeX << 32) | (uint32)sizeY;
+		return CityHash64WithSeed(reinterpret_cast<const char*>(pixels), (uint32)numBytes, seed);
+	}
+
+	uint64 Perceptual(const FFloat16Color* pixels, int32 sizeX, int32 sizeY)
+	{
+		constexpr int32 CellsX = 9;
+		constexpr int32 CellsY = 8;
+		float sums[CellsY][CellsX] = {};
+		int32 counts[CellsY][CellsX] = {};
+		for (int32 y = 0; y < sizeY; y++)
+		{
+			const int32 cellY = y * CellsY / sizeY;
+			const FFloat16Color* row = pixels + (int64)y * sizeX;
+			for (int32 x = 0; x < sizeX; x++)
+			{
+				const int32 cellX = x * CellsX / sizeX;
+				const FLinearColor color(row[x]);
+				sums[cellY][cellX] += color.GetLuminance() * color.A;
+				counts[cellY][cellX]++;
+			}
+		}
+
+		uint64 hash = 0;
+		for (int32 y = 0; y < CellsY; y++)
+		{
+			for (int32 x = 0; x < CellsX - 1; x++)
+			{
+				const float left = counts[y][x] > 0 ? sums[y][x] / counts[y][x] : 0.f;
+				const float right = counts[y][x + 1] > 0 ? sums[y][x + 1] / counts[y][x + 1] : 0.f;
+				if (left > right)
+				{
+					hash |= 1ull << (y * (CellsX - 1) + x);
+				}
+			}
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace ThumbnailImageHash
+{
+	// CityHash of the pixel bytes seeded with the size. Equal hashes are treated as identical images, a 64 bit collision
+	// between two cached thumbnails is not worth a byte compare.
+	uint64 Exact(const uint8* pixels, int64 numBytes, int32 sizeX, int32 sizeY);
+
+	/**
+	 * Difference hash of a float16 RGBA image: coverage weighted luminance averaged into 9 x 8 cells, one bit per cell
+	 * telling whether it is brighter than its right neighbour. Independent of size and robust to the small shading and
+	 * anti aliasing differences between renders of visually identical meshes.
+	 */
+	uint64 Perceptual(const FFloat16Color* pixels, int32 sizeX, int32 sizeY);
+
+	// Number of differing bits between two perceptual hashes.
+	inline int32 Distance(uint64 a, uint64 b)
+	{
+		return FMath::CountBits(a ^ b);
+	}
+}
@@ -4,6 +4,8 @@
 
 IMPLEMENT_MODULE(FThumbnailPlugin, ThumbnailPlugin)
 
+DEFINE_LOG_CATEGORY(LogThumbnail);
+
 void FThumbnailPlugin::StartupModule()
 {
 	
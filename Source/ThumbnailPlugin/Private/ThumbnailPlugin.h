@@ -4,6 +4,8 @@
 
 #include "Modules/ModuleManager.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogThumbnail, Log, All);
+
 class FThumbnailPlugin : public IModuleInterface
 {
 public:
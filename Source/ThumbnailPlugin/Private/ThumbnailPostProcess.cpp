@@ -0,0 +1,463 @@
+#include "ThumbnailPostProcess.h"
+#include "ThumbnailRequest.h"
+#include "ThumbnailPlugin.h"
+#include "Async/ParallelFor.h"
+#include "Math/VectorRegister.h"
+#include "HAL/IConsoleManager.h"
+
+namespace ThumbnailPostProcess
+{
+	// Coverage at or below one 8 bit step counts as transparent for trimming.
+	static constexpr float OpaqueThreshold = 1.f / 255.f;
+
+	// Splits rows into tasks of a few thousand pixels, single rows of a 64 px thumbnail are not worth scheduling.
+	template <typename TFunction>
+	static void ForEachRow(int32 sizeX, int32 sizeY, TFunction&& function)
+	{
+		const int32 rowsPerTask = FMath::Max(1, 8192 / FMath::Max(sizeX, 1));
+		ParallelFor(FMath::DivideAndRoundUp(sizeY, rowsPerTask), [&](int32 task)
+		{
+			const int32 end = FMath::Min(sizeY, (task + 1) * rowsPerTask);
+			for (int32 y = task * rowsPerTask; y < end; y++)
+			{
+				function(y);
+			}
+		});
+	}
+
+	enum class EFilter
+	{
+		Max,
+		Box
+	};
+
+	/**
+	 * Separable square filter over a float plane. Max dilates the alpha channel for outlines, Box blurs it for shadows.
+	 * Both passes handle four neighbouring pixels per register, the vertical pass runs along whole rows.
+	 */
+	template <EFilter Filter>
+	static void SeparableFilter(const float* source, float* dest, int32 sizeX, int32 sizeY, int32 radius, bool bVectorized)
+	{
+		const int32 taps = radius * 2 + 1;
+		const float normalize = Filter == EFilter::Box ? 1.f / taps : 1.f;
+
+		TArray64<float> horizontal;
+		horizontal.SetNumUninitialized((int64)sizeX * sizeY);
+		ForEachRow(sizeX, sizeY, [&](int32 y)
+		{
+			// Zero padded so every tap is in range.
+			TArray<float, TInlineAllocator<1280>> padded;
+			padded.SetNumZeroed(sizeX + radius * 2);
+			FMemory::Memcpy(padded.GetData() + radius, source + (int64)y * sizeX, sizeX * sizeof(float));
+
+			float* out = horizontal.GetData() + (int64)y * sizeX;
+			int32 x = 0;
+			if (bVectorized)
+			{
+				for (; x + 4 <= sizeX; x += 4)
+				{
+					VectorRegister4Float value = VectorLoad(padded.GetData() + x);
+					for (int32 k = 1; k < taps; k++)
+					{
+						const VectorRegister4Float tap = VectorLoad(padded.GetData() + x + k);
+						value = Filter == EFilter::Max ? VectorMax(value, tap) : VectorAdd(value, tap);
+					}
+					VectorStore(VectorMultiply(value, VectorSetFloat1(normalize)), out + x);
+				}
+			}
+			for (; x < sizeX; x++)
+			{
+				float value = padded[x];
+				for (int32 k = 1; k < taps; k++)
+				{
+					value = Filter == EFilter::Max ? FMath::Max(value, padded[x + k]) : value + padded[x + k];
+				}
+				out[x] = value * normalize;
+			}
+		});
+
+		ForEachRow(sizeX, sizeY, [&](int32 y)
+		{
+			const int32 first = FMath::Max(y - radius, 0);
+			const int32 last = FMath::Min(y + radius, sizeY - 1);
+			float* out = dest + (int64)y * sizeX;
+			FMemory::Memcpy(out, horizontal.GetData() + (int64)first * sizeX, sizeX * sizeof(float));
+			for (int32 row = first + 1; row <= last; row++)
+			{
+				const float* in = horizontal.GetData() + (int64)row * sizeX;
+				int32 x = 0;
+				if (bVectorized)
+				{
+					for (; x + 4 <= sizeX; x += 4)
+					{
+						const VectorRegister4Float value = VectorLoad(out + x);
+						const VectorRegister4Float tap = VectorLoad(in + x);
+						VectorStore(Filter == EFilter::Max ? VectorMax(value, tap) : VectorAdd(value, tap), out + x);
+					}
+				}
+				for (; x < sizeX; x++)
+				{
+					out[x] = Filter == EFilter::Max ? FMath::Max(out[x], in[x]) : out[x] + in[x];
+				}
+			}
+			if (Filter == EFilter::Box)
+			{
+				// Rows past the edge count as transparent, so the sum is always divided by the full tap count.
+				for (int32 x = 0; x < sizeX; x++)
+				{
+					out[x] *= normalize;
+				}
+			}
+		});
+	}
+
+	// Premultiplied colors drawn under the image, in back to front order.
+	struct FCompositeLayers
+	{
+		const float* Shadow = nullptr;
+		const float* Outline = nullptr;
+		FLinearColor ShadowColor;
+		FLinearColor OutlineColor;
+		FLinearColor BackgroundColor;
+		bool bBackground = false;
+		bool bPremultiply = false;
+	};
+
+	static FLinearColor Premultiply(const FLinearColor& color)
+	{
+		return FLinearColor(color.R * color.A, color.G * color.A, color.B * color.A, color.A);
+	}
+
+	static void CompositeRowScalar(FLinearColor* row, int32 sizeX, const FCompositeLayers& layers, int32& outMinX, int32& outMaxX)
+	{
+		for (int32 x = 0; x < sizeX; x++)
+		{
+			FLinearColor color = Premultiply(row[x]);
+			FLinearColor under(0.f, 0.f, 0.f, 0.f);
+			if (layers.Shadow)
+			{
+				under = layers.ShadowColor * layers.Shadow[x];
+			}
+			if (layers.Outline)
+			{
+				const FLinearColor outline = layers.OutlineColor * layers.Outline[x];
+				under = outline + under * (1.f - outline.A);
+			}
+			color = color + under * (1.f - color.A);
+			if (color.A > OpaqueThreshold)
+			{
+				outMinX = FMath::Min(outMinX, x);
+				outMaxX = x;
+			}
+			if (layers.bBackground)
+			{
+				color = color + layers.BackgroundColor * (1.f - color.A);
+			}
+			if (!layers.bPremultiply)
+			{
+				const float inverseAlpha = color.A > 0.f ? 1.f / color.A : 0.f;
+				color = FLinearColor(color.R * inverseAlpha, color.G * inverseAlpha, color.B * inverseAlpha, color.A);
+			}
+			row[x] = color;
+		}
+	}
+
+	static void CompositeRowVector(FLinearColor* row, int32 sizeX, const FCompositeLayers& layers, int32& outMinX, int32& outMaxX)
+	{
+		const VectorRegister4Float one = VectorOneFloat();
+		const VectorRegister4Float zero = VectorZeroFloat();
+		const VectorRegister4Float rgbMask = GlobalVectorConstants::XYZMask();
+		const VectorRegister4Float threshold = VectorSetFloat1(OpaqueThreshold);
+		const VectorRegister4Float shadowColor = VectorLoad(&layers.ShadowColor.R);
+		const VectorRegister4Float outlineColor = VectorLoad(&layers.OutlineColor.R);
+		const VectorRegister4Float backgroundColor = VectorLoad(&layers.BackgroundColor.R);
+
+		for (int32 x = 0; x < sizeX; x++)
+		{
+			const VectorRegister4Float straight = VectorLoad(&row[x].R);
+			VectorRegister4Float color = VectorSelect(rgbMask, VectorMultiply(straight, VectorReplicate(straight, 3)), straight);
+			VectorRegister4Float under = zero;
+			if (layers.Shadow)
+			{
+				under = VectorMultiply(shadowColor, VectorSetFloat1(layers.Shadow[x]));
+			}
+			if (layers.Outline)
+			{
+				const VectorRegister4Float outline = VectorMultiply(outlineColor, VectorSetFloat1(layers.Outline[x]));
+				under = VectorMultiplyAdd(under, VectorSubtract(one, VectorReplicate(outline, 3)), outline);
+			}
+			color = VectorMultiplyAdd(under, VectorSubtract(one, VectorReplicate(color, 3)), color);
+			if (VectorMaskBits(VectorCompareGT(color, threshold)) & 0x8)
+			{
+				outMinX = FMath::Min(outMinX, x);
+				outMaxX = x;
+			}
+			if (layers.bBackground)
+			{
+				color = VectorMultiplyAdd(backgroundColor, VectorSubtract(one, VectorReplicate(color, 3)), color);
+			}
+			if (!layers.bPremultiply)
+			{
+				const VectorRegister4Float alpha = VectorReplicate(color, 3);
+				const VectorRegister4Float straightColor = VectorSelect(VectorCompareGT(alpha, zero), VectorDivide(color, alpha), zero);
+				color = VectorSelect(rgbMask, straightColor, color);
+			}
+			VectorStore(color, &row[x].R);
+		}
+	}
+
+	FIntRect Apply(FFloat16Color* pixels, int32 sizeX, int32 sizeY, const FThumbnailPostProcess& settings, bool bVectorized)
+	{
+		const int64 numPixels = (int64)sizeX * sizeY;
+		const bool bOutline = settings.OutlineWidth > 0;
+		const bool bShadow = settings.bDropShadow && settings.ShadowColor.A > 0.f;
+
+		TArray64<float> alpha;
+		if (bOutline || bShadow)
+		{
+			alpha.SetNumUninitialized(numPixels);
+			ForEachRow(sizeX, sizeY, [&](int32 y)
+			{
+				const int64 offset = (int64)y * sizeX;
+				for (int32 x = 0; x < sizeX; x++)
+				{
+					alpha[offset + x] = pixels[offset + x].A.GetFloat();
+				}
+			});
+		}
+
+		TArray64<float> outline;
+		if (bOutline)
+		{
+			outline.SetNumUninitialized(numPixels);
+			SeparableFilter<EFilter::Max>(alpha.GetData(), outline.GetData(), sizeX, sizeY, settings.OutlineWidth, bVectorized);
+		}
+
+		TArray64<float> shadow;
+		if (bShadow)
+		{
+			const FIntPoint offset = settings.ShadowOffset;
+			shadow.SetNumZeroed(numPixels);
+			ForEachRow(sizeX, sizeY, [&](int32 y)
+			{
+				const int32 sourceY = y - offset.Y;
+				const int32 firstX = FMath::Max(offset.X, 0);
+				const int32 count = sizeX - FMath::Abs(offset.X);
+				if (sourceY >= 0 && sourceY < sizeY && count > 0)
+				{
+					FMemory::Memcpy(shadow.GetData() + (int64)y * sizeX + firstX, alpha.GetData() + (int64)sourceY * sizeX + firstX - offset.X, count * sizeof(float));
+				}
+			});
+			if (settings.ShadowBlur > 0)
+			{
+				TArray64<float> shifted = MoveTemp(shadow);
+				shadow.SetNumUninitialized(numPixels);
+				SeparableFilter<EFilter::Box>(shifted.GetData(), shadow.GetData(), sizeX, sizeY, settings.ShadowBlur, bVectorized);
+			}
+		}
+
+		FCompositeLayers layers;
+		layers.ShadowColor = Premultiply(settings.ShadowColor);
+		layers.OutlineColor = Premultiply(settings.OutlineColor);
+		layers.BackgroundColor = Premultiply(settings.BackgroundColor);
+		layers.bBackground = settings.bFillBackground;
+		layers.bPremultiply = settings.bPremultiplyAlpha;
+		// Trimming on its own only has to find the bounds, the pixels are left untouched.
+		const bool bWrite = bOutline || bShadow || settings.bFillBackground || settings.bPremultiplyAlpha;
+
+		TArray<FIntPoint> rowBounds;
+		rowBounds.SetNumUninitialized(sizeY);
+		ForEachRow(sizeX, sizeY, [&](int32 y)
+		{
+			const int64 offset = (int64)y * sizeX;
+			TArray<FLinearColor, TInlineAllocator<1024>> row;
+			row.SetNumUninitialized(sizeX);
+			for (int32 x = 0; x < sizeX; x++)
+			{
+				row[x] = FLinearColor(pixels[offset + x]);
+			}
+
+			FCompositeLayers rowLayers = layers;
+			rowLayers.Shadow = bShadow ? shadow.GetData() + offset : nullptr;
+			rowLayers.Outline = bOutline ? outline.GetData() + offset : nullptr;
+			FIntPoint& bounds = rowBounds[y];
+			bounds = FIntPoint(sizeX, -1);
+			if (bVectorized)
+			{
+				CompositeRowVector(row.GetData(), sizeX, rowLayers, bounds.X, bounds.Y);
+			}
+			else
+			{
+				CompositeRowScalar(row.GetData(), sizeX, rowLayers, bounds.X, bounds.Y);
+			}
+
+			if (bWrite)
+			{
+				for (int32 x = 0; x < sizeX; x++)
+				{
+					pixels[offset + x] = FFloat16Color(row[x]);
+				}
+			}
+		});
+
+		FIntRect bounds(sizeX, sizeY, -1, -1);
+		for (int32 y = 0; y < sizeY; y++)
+		{
+			if (rowBounds[y].Y >= 0)
+			{
+				bounds.Min.X = FMath::Min(bounds.Min.X, rowBounds[y].X);
+				bounds.Max.X = FMath::Max(bounds.Max.X, rowBounds[y].Y + 1);
+				bounds.Min.Y = FMath::Min(bounds.Min.Y, y);
+				bounds.Max.Y = y + 1;
+			}
+		}
+		if (bounds.Max.Y < 0)
+		{
+			return FIntRect();
+		}
+		bounds.InflateRect(FMath::Max(settings.TrimPadding, 0));
+		bounds.Clip(FIntRect(0, 0, sizeX, sizeY));
+		return bounds;
+	}
+
+	void Crop(FFloat16Color* pixels, int32 sizeX, const FIntRect& bounds)
+	{
+		const int32 width = bounds.Width();
+		// Rows only ever move towards the front, so copying in order never overwrites a row that is still to be read.
+		for (int32 y = bounds.Min.Y; y < bounds.Max.Y; y++)
+		{
+			FMemory::Memmove(pixels + (int64)(y - bounds.Min.Y) * width, pixels + (int64)y * sizeX + bounds.Min.X, width * sizeof(FFloat16Color));
+		}
+	}
+
+	// Piecewise sRGB curve. The power segment is a fit over three chained square roots instead of pow, which has no
+	// SIMD form on every platform. It stays well within one 8 bit step of the exact curve.
+	static VectorRegister4Float LinearToSRGB(const VectorRegister4Float& color)
+	{
+		const VectorRegister4Float s1 = VectorSqrt(color);
+		const VectorRegister4Float s2 = VectorSqrt(s1);
+		const VectorRegister4Float s3 = VectorSqrt(s2);
+		VectorRegister4Float curve = VectorMultiply(s1, VectorSetFloat1(0.662002687f));
+		curve = VectorMultiplyAdd(s2, VectorSetFloat1(0.684122060f), curve);
+		curve = VectorMultiplyAdd(s3, VectorSetFloat1(-0.323583601f), curve);
+		curve = VectorMultiplyAdd(color, VectorSetFloat1(-0.0225411470f), curve);
+		const VectorRegister4Float linear = VectorMultiply(color, VectorSetFloat1(12.92f));
+		return VectorSelect(VectorCompareGT(color, VectorSetFloat1(0.0031308f)), curve, linear);
+	}
+
+	void ToColor(const FFloat16Color* source, int64 numPixels, bool bSRGB, bool bBGRA, uint8* dest, bool bVectorized)
+	{
+		constexpr int64 PixelsPerTask = 8192;
+		ParallelFor((int32)FMath::DivideAndRoundUp<int64>(numPixels, PixelsPerTask), [&](int32 task)
+		{
+			const int64 begin = task * PixelsPerTask;
+			const int64 end = FMath::Min(begin + PixelsPerTask, numPixels);
+			if (!bVectorized)
+			{
+				for (int64 i = begin; i < end; i++)
+				{
+					const FColor color = FLinearColor(source[i]).ToFColor(bSRGB);
+					uint8* out = dest + i * 4;
+					out[0] = bBGRA ? color.B : color.R;
+					out[1] = color.G;
+					out[2] = bBGRA ? color.R : color.B;
+					out[3] = color.A;
+				}
+				return;
+			}
+
+			const VectorRegister4Float zero = VectorZeroFloat();
+			const VectorRegister4Float one = VectorOneFloat();
+			const VectorRegister4Float rgbMask = GlobalVectorConstants::XYZMask();
+			const VectorRegister4Float scale = VectorSetFloat1(255.f);
+			const VectorRegister4Float half = VectorSetFloat1(0.5f);
+			for (int64 i = begin; i < end; i++)
+			{
+				const FLinearColor linear(source[i]);
+				VectorRegister4Float color = VectorMin(VectorMax(VectorLoad(&linear.R), zero), one);
+				if (bSRGB)
+				{
+					// Alpha stays linear.
+					color = VectorSelect(rgbMask, LinearToSRGB(color), color);
+				}
+				color = VectorMultiplyAdd(color, scale, half);
+				if (bBGRA)
+				{
+					color = VectorSwizzle(color, 2, 1, 0, 3);
+				}
+				VectorStoreByte4(color, dest + i * 4);
+			}
+		});
+	}
+
+	static void RunBenchmark()
+	{
+		FThumbnailPostProcess settings;
+		settings.bPremultiplyAlpha = true;
+		settings.bTrimTransparentBorder = true;
+		settings.bFillBackground = true;
+		settings.BackgroundColor = FLinearColor(0.1f, 0.1f, 0.12f, 1.f);
+		settings.OutlineWidth = 2;
+		settings.bDropShadow = true;
+
+		auto time = [](int32 iterations, TFunctionRef<void()> prepare, TFunctionRef<void()> kernel)
+		{
+			double total = 0.0;
+			for (int32 i = 0; i < iterations; i++)
+			{
+				prepare();
+				const double start = FPlatformTime::Seconds();
+				kernel();
+				total += FPlatformTime::Seconds() - start;
+			}
+			return total * 1000.0 / iterations;
+		};
+
+		for (int32 size = 64; size <= 1024; size *= 2)
+		{
+			// HDR disc with a soft edge on a transparent background, roughly what a capture looks like.
+			const int64 numPixels = (int64)size * size;
+			TArray64<FFloat16Color> source;
+			source.SetNumUninitialized(numPixels);
+			for (int32 y = 0; y < size; y++)
+			{
+				for (int32 x = 0; x < size; x++)
+				{
+					const float distance = FVector2f(x - size * 0.5f, y - size * 0.5f).Size() / (size * 0.35f);
+					const float coverage = FMath::Clamp((1.f - distance) * 8.f, 0.f, 1.f);
+					source[(int64)y * size + x] = FFloat16Color(FLinearColor(1.5f * x / size, 0.5f, 2.f * y / size, coverage));
+				}
+			}
+			TArray64<FFloat16Color> work;
+			work.SetNumUninitialized(numPixels);
+			TArray64<uint8> scalarColors;
+			TArray64<uint8> vectorColors;
+			scalarColors.SetNumUninitialized(numPixels * 4);
+			vectorColors.SetNumUninitialized(numPixels * 4);
+
+			const int32 iterations = FMath::Clamp(4 * 1024 * 1024 / (int32)numPixels, 4, 256);
+			auto reset = [&]() { FMemory::Memcpy(work.GetData(), source.GetData(), numPixels * sizeof(FFloat16Color)); };
+			auto noop = []() {};
+
+			const double applyScalar = time(iterations, reset, [&]() { Apply(work.GetData(), size, size, settings, false); });
+			const double applyVector = time(iterations, reset, [&]() { Apply(work.GetData(), size, size, settings, true); });
+			const double colorScalar = time(iterations, noop, [&]() { ToColor(source.GetData(), numPixels, true, true, scalarColors.GetData(), false); });
+			const double colorVector = time(iterations, noop, [&]() { ToColor(source.GetData(), numPixels, true, true, vectorColors.GetData(), true); });
+
+			int32 maxError = 0;
+			for (int64 i = 0; i < numPixels * 4; i++)
+			{
+				maxError = FMath::Max(maxError, FMath::Abs(scalarColors[i] - vectorColors[i]));
+			}
+
+			UE_LOG(LogThumbnail, Display, TEXT("%4d px  composite: scalar %7.3f ms, vector %7.3f ms (%.2fx)  sRGB: scalar %7.3f ms, vector %7.3f ms (%.2fx, max error %d)"),
+				size, applyScalar, applyVector, applyScalar / FMath::Max(applyVector, 1e-6),
+				colorScalar, colorVector, colorScalar / FMath::Max(colorVector, 1e-6), maxError);
+		}
+	}
+
+	static FAutoConsoleCommand BenchmarkCommand(
+		TEXT("Thumbnail.BenchmarkPostProcess"),
+		TEXT("Times the scalar and vectorized thumbnail post processing kernels from 64 to 1024 pixels and logs the speedup."),
+		FConsoleCommandDelegate::CreateStatic(&RunBenchmark));
+}
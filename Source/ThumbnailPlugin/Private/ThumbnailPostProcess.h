@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FThumbnailPostProcess;
+
+namespace ThumbnailPostProcess
+{
+	/**
+	 * Runs the enabled passes of settings over a float16 RGBA image in place: drop shadow and outline built from
+	 * the alpha channel, background fill and alpha premultiply, composited in one pass per row. Every pass works on
+	 * whole pixels in SIMD registers and is split across ParallelFor workers by row. bVectorized = false runs the
+	 * scalar reference kernels instead, for benchmarking.
+	 * Returns the bounds of everything but the background fill, grown by TrimPadding, or an empty rect when nothing is opaque.
+	 */
+	FIntRect Apply(FFloat16Color* pixels, int32 sizeX, int32 sizeY, const FThumbnailPostProcess& settings, bool bVectorized = true);
+
+	// Moves the pixels inside bounds to the front of the buffer as a tightly packed image of bounds' size.
+	void Crop(FFloat16Color* pixels, int32 sizeX, const FIntRect& bounds);
+
+	// Clamped HDR to 8 bit with an optional sRGB curve, RGBA or BGRA byte order. Replaces FLinearColor::ToFColor per pixel.
+	void ToColor(const FFloat16Color* source, int64 numPixels, bool bSRGB, bool bBGRA, uint8* dest, bool bVectorized = true);
+}
@@ -0,0 +1,230 @@
+#include "ThumbnailReadback.h"
+#include "ThumbnailPostProcess.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "RHIGPUReadback.h"
+#include "Tasks/Task.h"
+
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+
+int32 FThumbnailPixelRequest::GetBytesPerPixel(EThumbnailPixelFormat format)
+{
+	switch (format)
+	{
+	case EThumbnailPixelFormat::BGRA8:
+	case EThumbnailPixelFormat::RGBA8:
+		return 4;
+	case EThumbnailPixelFormat::RGBA16F:
+		return sizeof(FFloat16Color);
+	case EThumbnailPixelFormat::RGBA32F:
+		return sizeof(FLinearColor);
+	}
+	return 0;
+}
+
+TArray64<uint8> FThumbnailPixelBufferPool::Acquire(int64 numBytes)
+{
+	TArray64<uint8> buffer;
+	{
+		FScopeLock lock(&Mutex);
+		for (int32 i = 0; i < FreeBuffers.Num(); i++)
+		{
+			if (FreeBuffers[i].Max() >= numBytes)
+			{
+				buffer = MoveTemp(FreeBuffers[i]);
+				FreeBuffers.RemoveAtSwap(i);
+				break;
+			}
+		}
+	}
+	buffer.SetNumUninitialized(numBytes, false);
+	return buffer;
+}
+void FThumbnailPixelBufferPool::Release(TArray64<uint8>&& buffer)
+{
+	if (buffer.Max() == 0)
+	{
+		return;
+	}
+	FScopeLock lock(&Mutex);
+	if (FreeBuffers.Num() < MaxPooledBuffers)
+	{
+		FreeBuffers.Add(MoveTemp(buffer));
+	}
+}
+
+FThumbnailPendingReadback::~FThumbnailPendingReadback()
+{
+}
+
+FThumbnailReadbackQueue::FThumbnailReadbackQueue()
+	: BufferPool(MakeShared<FThumbnailPixelBufferPool, ESPMode::ThreadSafe>())
+{
+	// Module lookups are not safe off the game thread, so resolve it up front for the workers.
+	ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+}
+
+void FThumbnailReadbackQueue::Enqueue(UTextureRenderTarget2D* target, const FThumbnailPixelRequest& request, FOnThumbnailPixels onComplete,
+	const FThumbnailPostProcess& postProcess)
+{
+	TSharedPtr<FThumbnailPendingReadback, ESPMode::ThreadSafe> pending = MakeShared<FThumbnailPendingReadback, ESPMode::ThreadSafe>();
+	pending->Readback = MakeUnique<FRHIGPUTextureReadback>(TEXT("ThumbnailReadback"));
+	pending->SizeX = target->SizeX;
+	pending->SizeY = target->SizeY;
+	pending->Request = request;
+	pending->PostProcess = postProcess;
+	pending->OnComplete = MoveTemp(onComplete);
+	Pending.Add(pending);
+
+	FTextureRenderTargetResource* resource = target->GameThread_GetRenderTargetResource();
+	ENQUEUE_RENDER_COMMAND(EnqueueThumbnailReadback)([resource, pending](FRHICommandListImmediate& RHICmdList)
+	{
+		FRHITexture* texture = resource->GetRenderTargetTexture();
+		RHICmdList.Transition(FRHITransitionInfo(texture, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+		pending->Readback->EnqueueCopy(RHICmdList, texture);
+		RHICmdList.Transition(FRHITransitionInfo(texture, ERHIAccess::CopySrc, ERHIAccess::SRVMask));
+	});
+}
+
+void FThumbnailReadbackQueue::Tick()
+{
+	for (const TSharedPtr<FThumbnailPendingReadback, ESPMode::ThreadSafe>& pending : Pending)
+	{
+		if (pending->bFinished || pending->bPollQueued)
+		{
+			continue;
+		}
+		pending->bPollQueued = true;
+
+		TSharedRef<FThumbnailPixelBufferPool, ESPMode::ThreadSafe> pool = BufferPool;
+		IImageWrapperModule* imageWrapperModule = ImageWrapperModule;
+		ENQUEUE_RENDER_COMMAND(PollThumbnailReadback)([pending, pool, imageWrapperModule](FRHICommandListImmediate& RHICmdList)
+		{
+			if (!pending->Readback->IsReady())
+			{
+				pending->bPollQueued = false;
+				return;
+			}
+			pending->CapturedTime = FPlatformTime::Seconds();
+
+			const int64 rowBytes = (int64)pending->SizeX * sizeof(FFloat16Color);
+			TArray64<uint8> raw = pool->Acquire(rowBytes * pending->SizeY);
+
+			int32 rowPitchInPixels = 0;
+			const uint8* data = static_cast<const uint8*>(pending->Readback->Lock(rowPitchInPixels));
+			const int64 pitchBytes = (int64)FMath::Max(rowPitchInPixels, pending->SizeX) * sizeof(FFloat16Color);
+			for (int32 y = 0; y < pending->SizeY; y++)
+			{
+				FMemory::Memcpy(raw.GetData() + y * rowBytes, data + y * pitchBytes, rowBytes);
+			}
+			pending->Readback->Unlock();
+			pending->bFinished = true;
+
+			UE::Tasks::Launch(UE_SOURCE_LOCATION, [pending, pool, imageWrapperModule, raw = MoveTemp(raw)]() mutable
+			{
+				Deliver(*pending, raw, *pool, imageWrapperModule);
+				pool->Release(MoveTemp(raw));
+			});
+		});
+	}
+	Pending.RemoveAll([](const TSharedPtr<FThumbnailPendingReadback, ESPMode::ThreadSafe>& pending)
+	{
+		return pending->bFinished.load();
+	});
+}
+
+void FThumbnailReadbackQueue::ConvertPixels(const FFloat16Color* source, int64 numPixels, EThumbnailPixelFormat format, bool bSRGB, uint8* dest)
+{
+	switch (format)
+	{
+	case EThumbnailPixelFormat::BGRA8:
+	case EThumbnailPixelFormat::RGBA8:
+		ThumbnailPostProcess::ToColor(source, numPixels, bSRGB, format == EThumbnailPixelFormat::BGRA8, dest);
+		break;
+	case EThumbnailPixelFormat::RGBA16F:
+		FMemory::Memcpy(dest, source, numPixels * sizeof(FFloat16Color));
+		break;
+	case EThumbnailPixelFormat::RGBA32F:
+	{
+		FLinearColor* out = reinterpret_cast<FLinearColor*>(dest);
+		for (int64 i = 0; i < numPixels; i++)
+		{
+			out[i] = FLinearColor(source[i]);
+		}
+		break;
+	}
+	}
+}
+
+void FThumbnailReadbackQueue::Deliver(FThumbnailPendingReadback& pending, TArray64<uint8>& raw, FThumbnailPixelBufferPool& pool, IImageWrapperModule* imageWrapperModule)
+{
+	const FThumbnailPixelRequest& request = pending.Request;
+	int32 sizeX = pending.SizeX;
+	int32 sizeY = pending.SizeY;
+	if (pending.PostProcess.IsActive())
+	{
+		FFloat16Color* pixels = reinterpret_cast<FFloat16Color*>(raw.GetData());
+		const FIntRect bounds = ThumbnailPostProcess::Apply(pixels, sizeX, sizeY, pending.PostProcess);
+		if (pending.PostProcess.bTrimTransparentBorder && bounds.Area() > 0)
+		{
+			ThumbnailPostProcess::Crop(pixels, sizeX, bounds);
+			sizeX = bounds.Width();
+			sizeY = bounds.Height();
+		}
+	}
+	const int64 numPixels = (int64)sizeX * sizeY;
+	const int64 numBytes = numPixels * FThumbnailPixelRequest::GetBytesPerPixel(request.Format);
+	const FFloat16Color* source = reinterpret_cast<const FFloat16Color*>(raw.GetData());
+
+	FThumbnailPixels result;
+	result.SizeX = sizeX;
+	result.SizeY = sizeY;
+	result.Format = request.Format;
+	result.CapturedTime = pending.CapturedTime;
+
+	if (request.Destination.Num() > 0 && request.Destination.Num() < numBytes)
+	{
+		ensureMsgf(false, TEXT("Thumbnail pixel destination is %d bytes, %lld are required."), request.Destination.Num(), numBytes);
+		pending.OnComplete.ExecuteIfBound(result);
+		return;
+	}
+
+	TArray64<uint8> pooled;
+	uint8* dest = request.Destination.GetData();
+	if (request.Destination.Num() == 0)
+	{
+		pooled = pool.Acquire(numBytes);
+		dest = pooled.GetData();
+	}
+	ConvertPixels(source, numPixels, request.Format, request.bSRGB, dest);
+	result.Pixels = TArrayView<const uint8>(dest, numBytes);
+
+	TArray64<uint8> encoded;
+	if (request.Encoding != EThumbnailImageEncoding::None)
+	{
+		TArray64<uint8> bgra;
+		const uint8* encodeSource = dest;
+		if (request.Format != EThumbnailPixelFormat::BGRA8)
+		{
+			bgra = pool.Acquire(numPixels * 4);
+			ConvertPixels(source, numPixels, EThumbnailPixelFormat::BGRA8, request.bSRGB, bgra.GetData());
+			encodeSource = bgra.GetData();
+		}
+
+		const bool bPNG = request.Encoding == EThumbnailImageEncoding::PNG;
+		TSharedPtr<IImageWrapper> imageWrapper = imageWrapperModule->CreateImageWrapper(bPNG ? EImageFormat::PNG : EImageFormat::JPEG);
+		if (imageWrapper.IsValid() && imageWrapper->SetRaw(encodeSource, numPixels * 4, sizeX, sizeY, ERGBFormat::BGRA, 8))
+		{
+			encoded = imageWrapper->GetCompressed(bPNG ? 0 : request.Quality);
+			result.Encoded = TArrayView<const uint8>(encoded.GetData(), encoded.Num());
+		}
+		pool.Release(MoveTemp(bgra));
+	}
+
+	result.bSuccess = request.Encoding == EThumbnailImageEncoding::None || result.Encoded.Num() > 0;
+	pending.OnComplete.ExecuteIfBound(result);
+
+	pool.Release(MoveTemp(pooled));
+}
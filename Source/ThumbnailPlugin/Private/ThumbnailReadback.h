@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ThumbnailPixels.h"
+#include "ThumbnailRequest.h"
+#include <atomic>
+
+class FRHIGPUTextureReadback;
+class IImageWrapperModule;
+class UTextureRenderTarget2D;
+
+/** Recycles the byte buffers used for readbacks and pooled pixel delivery. Safe to use from any thread. */
+class FThumbnailPixelBufferPool
+{
+public:
+	TArray64<uint8> Acquire(int64 numBytes);
+	void Release(TArray64<uint8>&& buffer);
+
+private:
+	FCriticalSection Mutex;
+	TArray<TArray64<uint8>> FreeBuffers;
+
+	static constexpr int32 MaxPooledBuffers = 16;
+};
+
+struct FThumbnailPendingReadback
+{
+	TUniquePtr<FRHIGPUTextureReadback> Readback;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	FThumbnailPixelRequest Request;
+	FThumbnailPostProcess PostProcess;
+	FOnThumbnailPixels OnComplete;
+
+	// Set on the render thread by the poll that finds the readback ready.
+	double CapturedTime = 0.0;
+
+	std::atomic<bool> bPollQueued = false;
+	std::atomic<bool> bFinished = false;
+
+	~FThumbnailPendingReadback();
+};
+
+/**
+ * Copies render targets into staging textures and hands the pixels to a worker thread once the GPU is done.
+ * Post processing, conversion into the requested format and any image encoding happen on the worker, the game thread only polls.
+ */
+class FThumbnailReadbackQueue
+{
+public:
+	FThumbnailReadbackQueue();
+
+	void Enqueue(UTextureRenderTarget2D* target, const FThumbnailPixelRequest& request, FOnThumbnailPixels onComplete,
+		const FThumbnailPostProcess& postProcess = FThumbnailPostProcess());
+	void Tick();
+	bool IsEmpty() const { return Pending.IsEmpty(); };
+
+	static void ConvertPixels(const FFloat16Color* source, int64 numPixels, EThumbnailPixelFormat format, bool bSRGB, uint8* dest);
+
+private:
+	static void Deliver(FThumbnailPendingReadback& pending, TArray64<uint8>& raw, FThumbnailPixelBufferPool& pool, IImageWrapperModule* imageWrapperModule);
+
+	TArray<TSharedPtr<FThumbnailPendingReadback, ESPMode::ThreadSafe>> Pending;
+	TSharedRef<FThumbnailPixelBufferPool, ESPMode::ThreadSafe> BufferPool;
+	IImageWrapperModule* ImageWrapperModule = nullptr;
+};
@@ -0,0 +1,294 @@
+#include "ThumbnailRequest.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/SkeletalMesh.h"
+#include "GeometryCollection/GeometryCollectionObject.h"
+#include "ThumbnailLightingPreset.h"
+#include "Materials/MaterialInterface.h"
+#include "Materials/MaterialInstance.h"
+#include "Engine/Texture.h"
+#include "Engine/TextureCube.h"
+#include "RHI.h"
+#include "UObject/Package.h"
+
+uint32 FThumbnailPart::GetHash(const TArray<FThumbnailPart>& parts)
+{
+	uint32 hash = GetTypeHash(parts.Num());
+	for (const FThumbnailPart& part : parts)
+	{
+		hash = HashCombine(hash, GetTypeHash(part.StaticMesh.Get()));
+		hash = HashCombine(hash, GetTypeHash(part.SkeletalMesh.Get()));
+		hash = HashCombine(hash, GetTypeHash(part.Parent));
+		hash = HashCombine(hash, GetTypeHash(part.Socket));
+		hash = HashCombine(hash, GetTypeHash(part.bUseLeaderPose));
+		hash = HashCombine(hash, GetTypeHash(part.RelativeTransform.GetLocation()));
+		hash = HashCombine(hash, GetTypeHash(part.RelativeTransform.GetRotation().Euler()));
+		hash = HashCombine(hash, GetTypeHash(part.RelativeTransform.GetScale3D()));
+	}
+	return hash;
+}
+
+uint32 FThumbnailMaterialOverride::GetHash(const TArray<FThumbnailMaterialOverride>& overrides)
+{
+	if (overrides.IsEmpty())
+	{
+		return 0;
+	}
+	uint32 hash = GetTypeHash(overrides.Num());
+	for (const FThumbnailMaterialOverride& materialOverride : overrides)
+	{
+		hash = HashCombine(hash, GetTypeHash(materialOverride.Part));
+		hash = HashCombine(hash, GetTypeHash(materialOverride.Slot));
+		hash = HashCombine(hash, GetTypeHash(materialOverride.SlotName));
+		hash = HashCombine(hash, GetTypeHash(materialOverride.Material.Get()));
+		// Summed so the same parameters added in a different order hash the same.
+		uint32 parameterHash = 0;
+		for (const TPair<FName, float>& parameter : materialOverride.ScalarParameters)
+		{
+			parameterHash += HashCombine(GetTypeHash(parameter.Key), GetTypeHash(parameter.Value));
+		}
+		for (const TPair<FName, FLinearColor>& parameter : materialOverride.VectorParameters)
+		{
+			parameterHash += HashCombine(GetTypeHash(parameter.Key), GetTypeHash(parameter.Value));
+		}
+		hash = HashCombine(hash, parameterHash);
+	}
+	// Zero is reserved for no overrides.
+	return hash != 0 ? hash : 1;
+}
+
+uint32 FThumbnailPostProcess::GetHash() const
+{
+	if (!IsActive())
+	{
+		return 0;
+	}
+	uint32 hash = GetTypeHash(bPremultiplyAlpha);
+	hash = HashCombine(hash, GetTypeHash(bTrimTransparentBorder));
+	hash = HashCombine(hash, GetTypeHash(bTrimTransparentBorder ? TrimPadding : 0));
+	hash = HashCombine(hash, GetTypeHash(bFillBackground));
+	hash = HashCombine(hash, bFillBackground ? GetTypeHash(BackgroundColor) : 0);
+	hash = HashCombine(hash, GetTypeHash(OutlineWidth));
+	hash = HashCombine(hash, OutlineWidth > 0 ? GetTypeHash(OutlineColor) : 0);
+	hash = HashCombine(hash, GetTypeHash(bDropShadow));
+	if (bDropShadow)
+	{
+		hash = HashCombine(hash, GetTypeHash(ShadowOffset));
+		hash = HashCombine(hash, GetTypeHash(ShadowBlur));
+		hash = HashCombine(hash, GetTypeHash(ShadowColor));
+	}
+	// Zero is reserved for no post processing.
+	return hash != 0 ? hash : 1;
+}
+
+double FThumbnailTimeline::GetDuration(EThumbnailStage stage) const
+{
+	const double time = Get(stage);
+	if (time <= 0.0)
+	{
+		return -1.0;
+	}
+	for (int32 i = (int32)stage - 1; i >= 0; i--)
+	{
+		if (Stamps[i] > 0.0)
+		{
+			return time - Stamps[i];
+		}
+	}
+	return 0.0;
+}
+
+UObject* FThumbnailRequest::GetAsset() const
+{
+	if (StaticMesh)
+	{
+		return StaticMesh;
+	}
+	if (SkeletalMesh)
+	{
+		return SkeletalMesh;
+	}
+	if (GeometryCollection)
+	{
+		return GeometryCollection;
+	}
+	if (Parts.Num() > 0)
+	{
+		return Parts[0].StaticMesh ? (UObject*)Parts[0].StaticMesh : (UObject*)Parts[0].SkeletalMesh;
+	}
+	return nullptr;
+}
+FThumbnailCacheKey FThumbnailRequest::GetCacheKey() const
+{
+	FThumbnailCacheKey key;
+	key.Asset = GetAsset();
+	key.SizeX = SizeX;
+	key.SizeY = SizeY;
+	key.Quality = QualityProfile;
+	key.LightingPreset = LightingPreset;
+	key.PartsHash = Parts.Num() > 0 ? FThumbnailPart::GetHash(Parts) : 0;
+	key.OverridesHash = FThumbnailMaterialOverride::GetHash(MaterialOverrides);
+	key.PostProcessHash = PostProcess.GetHash();
+	return key;
+}
+
+namespace
+{
+	void AddPackage(const UObject* object, TSet<UPackage*>& packages)
+	{
+		UPackage* package = object ? object->GetPackage() : nullptr;
+		if (package && package != GetTransientPackage())
+		{
+			packages.Add(package);
+		}
+	}
+	// The whole parent chain down to the base material, and every texture any of them samples.
+	void AddMaterialPackages(const UMaterialInterface* material, TSet<UPackage*>& packages)
+	{
+		if (!material)
+		{
+			return;
+		}
+		for (const UMaterialInterface* current = material; current; )
+		{
+			AddPackage(current, packages);
+			const UMaterialInstance* instance = Cast<UMaterialInstance>(current);
+			current = instance ? instance->Parent.Get() : nullptr;
+		}
+		TArray<UTexture*> textures;
+		material->GetUsedTextures(textures, EMaterialQualityLevel::Num, true, GMaxRHIFeatureLevel, false);
+		for (const UTexture* texture : textures)
+		{
+			AddPackage(texture, packages);
+		}
+	}
+	void AddMeshPackages(const UStaticMesh* mesh, TSet<UPackage*>& packages)
+	{
+		if (!mesh)
+		{
+			return;
+		}
+		AddPackage(mesh, packages);
+		for (const FStaticMaterial& material : mesh->GetStaticMaterials())
+		{
+			AddMaterialPackages(material.MaterialInterface, packages);
+		}
+	}
+	void AddMeshPackages(USkeletalMesh* mesh, TSet<UPackage*>& packages)
+	{
+		if (!mesh)
+		{
+			return;
+		}
+		AddPackage(mesh, packages);
+		for (const FSkeletalMaterial& material : mesh->GetMaterials())
+		{
+			AddMaterialPackages(material.MaterialInterface, packages);
+		}
+	}
+}
+
+void FThumbnailRequest::GatherDependencies()
+{
+	TSet<UPackage*> packages;
+	AddMeshPackages(StaticMesh, packages);
+	AddMeshPackages(SkeletalMesh, packages);
+	if (GeometryCollection)
+	{
+		AddPackage(GeometryCollection, packages);
+		for (const UMaterialInterface* material : GeometryCollection->Materials)
+		{
+			AddMaterialPackages(material, packages);
+		}
+	}
+	for (const FThumbnailPart& part : Parts)
+	{
+		AddMeshPackages(part.StaticMesh, packages);
+		AddMeshPackages(part.SkeletalMesh, packages);
+	}
+	for (const FThumbnailMaterialOverride& materialOverride : MaterialOverrides)
+	{
+		AddMaterialPackages(materialOverride.Material, packages);
+	}
+	if (LightingPreset)
+	{
+		AddPackage(LightingPreset, packages);
+		AddPackage(LightingPreset->SkyCubemap, packages);
+	}
+
+	Dependencies.Reset(packages.Num());
+	for (UPackage* package : packages)
+	{
+		FThumbnailDependency& dependency = Dependencies.AddDefaulted_GetRef();
+		dependency.PackageName = package->GetFName();
+		dependency.Package = package;
+#if WITH_EDITORONLY_DATA
+		dependency.SavedHash = package->GetSavedHash();
+#endif
+	}
+}
+bool FThumbnailRequest::DependsOn(FName packageName) const
+{
+	return Dependencies.ContainsByPredicate([packageName](const FThumbnailDependency& dependency) { return dependency.PackageName == packageName; });
+}
+
+FThumbnailRequest* FThumbnailRequestPool::Allocate()
+{
+	FThumbnailRequest* request = nullptr;
+	if (FreeIndices.IsEmpty())
+	{
+		request = Requests.Add_GetRef(MakeUnique<FThumbnailRequest>()).Get();
+		request->Handle.Index = Requests.Num() - 1;
+	}
+	else
+	{
+		request = Requests[FreeIndices.Pop()].Get();
+	}
+	request->bInUse = true;
+	return request;
+}
+void FThumbnailRequestPool::Free(FThumbnailRequest* request)
+{
+	if (!request || Get(request->Handle) != request)
+	{
+		return;
+	}
+	FThumbnailRequestHandle handle = request->Handle;
+	handle.Generation++;
+
+	*request = FThumbnailRequest();
+	request->Handle = handle;
+	FreeIndices.Add(handle.Index);
+}
+FThumbnailRequest* FThumbnailRequestPool::Get(const FThumbnailRequestHandle& handle) const
+{
+	if (!Requests.IsValidIndex(handle.Index))
+	{
+		return nullptr;
+	}
+	FThumbnailRequest* request = Requests[handle.Index].Get();
+	return request->bInUse && request->Handle.Generation == handle.Generation ? request : nullptr;
+}
+void FThumbnailRequestPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	// Free records are reset, so their pointers are null and cost nothing to report.
+	for (TUniquePtr<FThumbnailRequest>& request : Requests)
+	{
+		Collector.AddReferencedObject(request->StaticMesh);
+		Collector.AddReferencedObject(request->SkeletalMesh);
+		Collector.AddReferencedObject(request->GeometryCollection);
+		Collector.AddReferencedObject(request->LightingPreset);
+		for (FThumbnailPart& part : request->Parts)
+		{
+			Collector.AddReferencedObject(part.StaticMesh);
+			Collector.AddReferencedObject(part.SkeletalMesh);
+		}
+		for (FThumbnailMaterialOverride& materialOverride : request->MaterialOverrides)
+		{
+			Collector.AddReferencedObject(materialOverride.Material);
+		}
+	}
+}
+FString FThumbnailRequestPool::GetReferencerName() const
+{
+	return TEXT("FThumbnailRequestPool");
+}
@@ -9,6 +9,8 @@
 #include "Engine/StaticMeshActor.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "GeometryCollection/GeometryCollectionObject.h"
+#include "ThumbnailLightingPreset.h"
+#include "ThumbnailRequest.h"
 
 FMatrix FThumbnailScene::OffsetViewMatrix = FMatrix(
 	FPlane(0, 1, 0, 0),
@@ -63,6 +65,11 @@ void FThumbnailScene::InitScene()
 	DirectionalLight->Mobility = EComponentMobility::Movable;
 	AddComponent(DirectionalLight, FTransform(FRotator(-45, 180, 0), FVector::ZeroVector, FVector::OneVector));
 
+	// Creates the live sky rig only when no preset is set.
+	ApplyLightingPreset();
+}
+void FThumbnailScene::CreateLiveSky()
+{
 	SkyAtmosphere = NewObject<USkyAtmosphereComponent>(GetTransientPackage(), NAME_None, RF_Transient);
 	SkyAtmosphere->Mobility = EComponentMobility::Movable;
 	AddComponent(SkyAtmosphere, FTransform::Identity);
@@ -72,6 +79,98 @@ void FThumbnailScene::InitScene()
 	SkyLight->Mobility = EComponentMobility::Movable;
 	AddComponent(SkyLight, FTransform::Identity);
 }
+void FThumbnailScene::SetLightingDirty(uint8 numFrames)
+{
+	// Preset lighting comes from an already filtered cubemap, swapping meshes in and out does not change it.
+	if (LightingPreset)
+	{
+		return;
+	}
+	LightingDirty = numFrames > LightingDirty ? numFrames : LightingDirty;
+}
+void FThumbnailScene::SetLightingPreset(UThumbnailLightingPreset* preset)
+{
+	if (preset == LightingPreset)
+	{
+		return;
+	}
+	LightingPreset = preset;
+	if (bSceneInitialized)
+	{
+		ApplyLightingPreset();
+	}
+	SetRenderDirty();
+}
+void FThumbnailScene::ReleasePreviewAssets()
+{
+	if (MeshActor)
+	{
+		MeshActor->Destroy();
+		MeshActor = nullptr;
+	}
+	for (TPair<TObjectPtr<UThumbnailLightingPreset>, TObjectPtr<USkyLightComponent>>& pair : PresetSkyLights)
+	{
+		Components.Remove(pair.Value);
+		pair.Value->UnregisterComponent();
+	}
+	PresetSkyLights.Empty();
+	LightingPreset = nullptr;
+	if (bSceneInitialized)
+	{
+		ApplyLightingPreset();
+	}
+	SetRenderDirty();
+}
+void FThumbnailScene::ApplyLightingPreset()
+{
+	for (TPair<TObjectPtr<UThumbnailLightingPreset>, TObjectPtr<USkyLightComponent>>& pair : PresetSkyLights)
+	{
+		pair.Value->SetVisibility(pair.Key == LightingPreset);
+	}
+
+	if (!LightingPreset)
+	{
+		if (!SkyLight)
+		{
+			CreateLiveSky();
+		}
+		SkyAtmosphere->SetVisibility(true);
+		SkyLight->SetVisibility(true);
+		DirectionalLight->SetWorldRotation(FRotator(-45, 180, 0));
+		DirectionalLight->SetIntensity(5);
+		DirectionalLight->SetLightColor(FLinearColor::White);
+		DirectionalLight->SetCastShadows(true);
+		SetLightingDirty();
+		return;
+	}
+
+	if (SkyLight)
+	{
+		SkyAtmosphere->SetVisibility(false);
+		SkyLight->SetVisibility(false);
+	}
+
+	if (!PresetSkyLights.Contains(LightingPreset))
+	{
+		USkyLightComponent* presetSkyLight = NewObject<USkyLightComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+		presetSkyLight->SourceType = ESkyLightSourceType::SLS_SpecifiedCubemap;
+		presetSkyLight->Cubemap = LightingPreset->SkyCubemap;
+		presetSkyLight->Intensity = LightingPreset->SkyIntensity;
+		presetSkyLight->LightColor = LightingPreset->SkyColor.ToFColor(true);
+		presetSkyLight->bRealTimeCapture = false;
+		presetSkyLight->Mobility = EComponentMobility::Movable;
+		AddComponent(presetSkyLight, FTransform::Identity);
+		PresetSkyLights.Add(LightingPreset, presetSkyLight);
+
+		// The cubemap still has to be filtered once, after that the processed sky survives being hidden and shown again.
+		LightingDirty = FMath::Max<uint8>(LightingDirty, 1);
+	}
+
+	DirectionalLight->SetWorldRotation(LightingPreset->DirectionalLightRotation);
+	DirectionalLight->SetIntensity(LightingPreset->DirectionalLightIntensity);
+	DirectionalLight->SetLightColor(LightingPreset->DirectionalLightColor);
+	DirectionalLight->SetCastShadows(LightingPreset->bCastShadows);
+}
 void FThumbnailScene::Uninitialize()
 {
 	if (ViewFamily)
@@ -174,6 +273,8 @@ void FThumbnailScene::AddReferencedObjects(FReferenceCollector& Collector)
 {
 	Collector.AddReferencedObjects(Components);
 	Collector.AddReferencedObject(PreviewWorld);
+	Collector.AddReferencedObject(LightingPreset);
+	Collector.AddReferencedObjects(PresetSkyLights);
 }
 
 FString FThumbnailScene::GetReferencerName() const
@@ -196,7 +297,8 @@ void FThumbnailScene::Tick(float DeltaTime)
 		}
 		PreviewWorld->SetBegunPlay(true);
 	}
-	if (LightingDirty > 0)
+	// Unlit profiles never read the sky capture, keep the dirty count for the next lit request.
+	if (LightingDirty > 0 && ThumbnailQuality::UsesLighting(RenderActor->GetQualityProfile()))
 	{
 		USkyLightComponent::UpdateSkyCaptureContents(PreviewWorld);
 		UReflectionCaptureComponent::UpdateReflectionCaptureContents(PreviewWorld, nullptr, false, false, true);
@@ -240,9 +342,9 @@ void FThumbnailScene::SetRenderTarget(UTextureRenderTarget2D* target)
 	RenderTarget = target;
 	if (RenderActor)
 	{
+		// The sky and reflection captures do not depend on the target, only the next frame does.
 		RenderActor->AssignRenderTarget(target);
 		SetRenderDirty();
-		SetLightingDirty();
 		if (RenderTarget)
 		{
 			RenderTargetSize.Max.X = RenderTarget->SizeX;
@@ -250,6 +352,15 @@ void FThumbnailScene::SetRenderTarget(UTextureRenderTarget2D* target)
 		}
 	}
 }
+void FThumbnailScene::SetQualityProfile(EThumbnailQualityProfile profile)
+{
+	if (!RenderActor || RenderActor->GetQualityProfile() == profile)
+	{
+		return;
+	}
+	RenderActor->ApplyQualityProfile(profile);
+	SetRenderDirty();
+}
 FVector FThumbnailScene::GetCameraLocation() const
 {
 	if (!RenderActor)
@@ -279,15 +390,7 @@ void FThumbnailScene::SetStaticMesh(UStaticMesh* mesh)
 		}
 	}
 	MeshActor->SetStaticMesh(mesh);
-	ARenderActor* renderActor = GetRenderActor();
-	const double meshRadius = MeshActor->GetMeshRadius();
-	ViewRotation = FRotator::ZeroRotator;
-	const FVector pos = FVector(-meshRadius * 1.5f, meshRadius, meshRadius);
-	renderActor->SetActorLocationAndRotation(pos, (-pos).Rotation());
-	renderActor->SetOrthoWidth(meshRadius * 2.f);
-
-	SetLightingDirty();
-	SetRenderDirty();
+	FrameMeshActor();
 
 }
 void FThumbnailScene::SetSkeletalMesh(USkeletalMesh* mesh)
@@ -311,15 +414,7 @@ void FThumbnailScene::SetSkeletalMesh(USkeletalMesh* mesh)
 		}
 	}
 	MeshActor->SetSkeletalMesh(mesh);
-	ARenderActor* renderActor = GetRenderActor();
-	const double meshRadius = MeshActor->GetMeshRadius();
-	ViewRotation = FRotator::ZeroRotator;
-	const FVector pos = FVector(-meshRadius * 1.5f, meshRadius, meshRadius);
-	renderActor->SetActorLocationAndRotation(pos, (-pos).Rotation());
-	renderActor->SetOrthoWidth(meshRadius * 2.f);
-
-	SetLightingDirty();
-	SetRenderDirty();
+	FrameMeshActor();
 }
 void FThumbnailScene::SetGeometryCollection(UGeometryCollection* collection)
 {
@@ -329,6 +424,42 @@ void FThumbnailScene::SetGeometryCollection(UGeometryCollection* collection)
 	}
 	
 	MeshActor->SetGeometryCollection(collection);
+	FrameMeshActor();
+}
+void FThumbnailScene::SetComposite(const TArray<FThumbnailPart>& parts)
+{
+	if (parts.IsEmpty())
+	{
+		return;
+	}
+	const uint32 partsHash = FThumbnailPart::GetHash(parts);
+	if (!MeshActor)
+	{
+		MeshActor = PreviewWorld->SpawnActor<AThumbnailPreviewMeshActor>();
+	}
+	else if (MeshActor->GetPartsHash() == partsHash)
+	{
+		return;
+	}
+	MeshActor->SetParts(parts, partsHash);
+	FrameMeshActor();
+}
+void FThumbnailScene::SetMaterialOverrides(const TArray<FThumbnailMaterialOverride>& overrides)
+{
+	if (!MeshActor)
+	{
+		return;
+	}
+	const uint32 overridesHash = FThumbnailMaterialOverride::GetHash(overrides);
+	if (MeshActor->GetMaterialOverridesHash() == overridesHash)
+	{
+		return;
+	}
+	MeshActor->SetMaterialOverrides(overrides, overridesHash);
+	SetRenderDirty();
+}
+void FThumbnailScene::FrameMeshActor()
+{
 	ARenderActor* renderActor = GetRenderActor();
 	const double meshRadius = MeshActor->GetMeshRadius();
 	ViewRotation = FRotator::ZeroRotator;
@@ -1,193 +1,105 @@
 #include "ThumbnailSubsystem.h"
-#include "ThumbnailScene.h"
-#include "Engine/StaticMesh.h"
-#include "Engine/TextureRenderTarget2D.h"
-#include "Components/SceneCaptureComponent2D.h"
-#include "GeometryCollection/GeometryCollection.h"
-#include "Actors/RenderActor.h"
-#include "Compression/OodleDataCompressionUtil.h"
-
-#include "IImageWrapper.h"
-#include "IImageWrapperModule.h"
-
-
+#include "ThumbnailEngineSubsystem.h"
+#include "Engine/Engine.h"
 
 void UThumbnailSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
-
-
-	TickDelegate = FTickerDelegate::CreateUObject(this, &UThumbnailSubsystem::ThumbnailTick);
-	
-
-	RenderTarget = NewObject<UTextureRenderTarget2D>(GetTransientPackage());
-	RenderTarget->RenderTargetFormat = RTF_RGBA16f;
-	RenderTarget->Filter = TextureFilter::TF_MAX;
-	RenderTarget->ClearColor = FLinearColor::Transparent;
-	RenderTarget->InitAutoFormat(128, 128);
-	RenderTarget->UpdateResourceImmediate(true);
-
+	Service = GEngine->GetEngineSubsystem<UThumbnailEngineSubsystem>();
+	SubmitService = Service.Get();
 }
 void UThumbnailSubsystem::Deinitialize()
 {
-	EndThumbnailProcessing();
+	if (Service)
+	{
+		SubmitService = nullptr;
+		Service->CancelRequests(FObjectKey(this));
+		Service = nullptr;
+	}
 	Super::Deinitialize();
 }
 
-UThumbnailQueuedEntry* UThumbnailSubsystem::QueueMeshThumbnail(UStaticMesh* mesh)
+template <typename TSubject>
+FThumbnailRequest* UThumbnailSubsystem::QueueOwnedThumbnail(const TSubject& subject)
 {
-	if (!mesh)
+	if (!Service)
 	{
 		return nullptr;
 	}
-	UThumbnailQueuedEntry* newEntry = QueueThumbnail();
-	newEntry->StaticMesh = mesh;
-	return newEntry;
-}
-UThumbnailQueuedEntry* UThumbnailSubsystem::QueueMeshThumbnail(USkeletalMesh* mesh)
-{
-	if (!mesh)
+	FThumbnailRequest* entry = Service->QueueMeshThumbnail(subject);
+	if (entry)
 	{
-		return nullptr;
+		entry->Owner = FObjectKey(this);
 	}
-	UThumbnailQueuedEntry* newEntry = QueueThumbnail();
-	newEntry->SkeletalMesh = mesh;
-	return newEntry;
+	return entry;
 }
-UThumbnailQueuedEntry* UThumbnailSubsystem::QueueMeshThumbnail(UGeometryCollection* collection)
+FThumbnailRequest* UThumbnailSubsystem::QueueMeshThumbnail(UStaticMesh* mesh)
 {
-	if (!collection)
-	{
-		return nullptr;
-	}
-	UThumbnailQueuedEntry* newEntry = QueueThumbnail();
-	newEntry->GeometryCollection = collection;
-	return newEntry;
+	return QueueOwnedThumbnail(mesh);
 }
-UThumbnailQueuedEntry* UThumbnailSubsystem::QueueThumbnail()
+FThumbnailRequest* UThumbnailSubsystem::QueueMeshThumbnail(USkeletalMesh* mesh)
 {
-	UThumbnailQueuedEntry* newEntry = NewObject<UThumbnailQueuedEntry>();
-	Queue.Add(newEntry);
-	if (!TickDelegateHandle.IsValid())
-	{
-		StartThumbnailProcessing();
-	}
-	return newEntry;
+	return QueueOwnedThumbnail(mesh);
 }
-bool UThumbnailSubsystem::ThumbnailTick(float DeltaTime)
+FThumbnailRequest* UThumbnailSubsystem::QueueMeshThumbnail(UGeometryCollection* collection)
 {
-
-	if (!PreviewScene)
-	{
-		PreviewScene = new FThumbnailScene();
-		PreviewScene->SetRenderTarget(RenderTarget);
-		PreviewScene->GetRenderActor()->SetProjection(ECameraProjectionMode::Orthographic);
-	}
-
-	if (!CurrentEntry)
-	{
-		if (Queue.IsEmpty())
-		{
-			EndThumbnailProcessing();
-			return true;
-		}
-		CurrentEntry = Queue.Pop();
-	}
-	switch (CurrentEntry->State)
-	{
-	case EJPBThumbnailRenderState::ThumbnailRenderState_Init:
-		DoInitState();
-		break;
-	case EJPBThumbnailRenderState::ThumbnailRenderState_Processing:
-		DoProcessingState();
-		break;
-	case EJPBThumbnailRenderState::ThumbnailRenderState_Completed:
-		DoCompletedState();
-		break;
-	}
-
-	PreviewScene->Tick(DeltaTime);
-
-	return true;
+	return QueueOwnedThumbnail(collection);
 }
-
-void UThumbnailSubsystem::DoInitState()
+FThumbnailRequest* UThumbnailSubsystem::QueueMeshThumbnail(const TArray<FThumbnailPart>& parts)
 {
-	if (CurrentEntry)
-	{
-		const double sizeX = CurrentEntry->SizeX;
-		const double sizeY = CurrentEntry->SizeY;
-
-		if (sizeX != RenderTargetSize.X || sizeY != RenderTargetSize.Y)
-		{
-			RenderTargetSize.X = sizeX;
-			RenderTargetSize.Y = sizeY;
-			RenderTarget->ResizeTarget(sizeX, sizeY);
-			RenderTarget->UpdateResourceImmediate(true);
-		}
-	}
-	if (UStaticMesh* staticMesh = CurrentEntry->StaticMesh)
-	{
-		PreviewScene->SetStaticMesh(staticMesh);
-	}
-	else if (USkeletalMesh* skeletalMesh = CurrentEntry->SkeletalMesh)
-	{
-		PreviewScene->SetSkeletalMesh(skeletalMesh);
-	}
-	else if (UGeometryCollection* collection = CurrentEntry->GeometryCollection)
-	{
-		PreviewScene->SetGeometryCollection(collection);
-	}
-	
-
-	PreviewScene->SetRenderDirty();
-	PreviewScene->SetLightingDirty();
-	CurrentEntry->State = EJPBThumbnailRenderState::ThumbnailRenderState_Processing;
-	CurrentEntry->ProcessingCount = 12;
+	return QueueOwnedThumbnail(parts);
 }
-void UThumbnailSubsystem::DoProcessingState()
+void UThumbnailSubsystem::SubmitThumbnail(FThumbnailSubmission&& submission)
 {
-	if (!CurrentEntry)
+	UThumbnailEngineSubsystem* service = SubmitService;
+	if (!service)
 	{
 		return;
 	}
-	int32& ProcessingCount = CurrentEntry->ProcessingCount;
-	ProcessingCount--;
-	if (ProcessingCount <= 0)
-	{
-		CurrentEntry->State = EJPBThumbnailRenderState::ThumbnailRenderState_Completed;
-		UTexture2D* newThumbnailTexture = RenderTarget->ConstructTexture2D(GetTransientPackage(), MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass()).ToString(), EObjectFlags::RF_Transient);
-		CurrentEntry->OnComplete.ExecuteIfBound(newThumbnailTexture);
-		CurrentEntry = nullptr;
-	}
+	submission.Owner = FObjectKey(this);
+	service->SubmitThumbnail(MoveTemp(submission));
 }
-void UThumbnailSubsystem::DoCompletedState()
+void UThumbnailSubsystem::CancelRequest(const FThumbnailRequestHandle& handle)
 {
-	if (CurrentEntry)
+	if (Service)
 	{
-		CurrentEntry->bComplete = true;
-		CurrentEntry = nullptr;
+		Service->CancelRequest(handle);
 	}
 }
-void UThumbnailSubsystem::EndThumbnailProcessing()
+void UThumbnailSubsystem::ReleaseRenderTarget(UTextureRenderTarget2D* renderTarget)
 {
-	if (TickDelegateHandle.IsValid())
+	if (Service)
 	{
-		FTSTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
-		TickDelegateHandle.Reset();
+		Service->ReleaseRenderTarget(renderTarget);
 	}
-	if (PreviewScene)
+}
+FThumbnailHandle UThumbnailSubsystem::PinThumbnail(UTexture2D* texture)
+{
+	return Service ? Service->PinThumbnail(texture) : FThumbnailHandle();
+}
+FThumbnailMemoryStats UThumbnailSubsystem::GetMemoryStats() const
+{
+	return Service ? Service->GetMemoryStats() : FThumbnailMemoryStats();
+}
+void UThumbnailSubsystem::SetDefaultLightingPreset(UThumbnailLightingPreset* preset)
+{
+	if (Service)
 	{
-		delete PreviewScene;
-		PreviewScene = nullptr;
+		Service->SetDefaultLightingPreset(preset);
 	}
-
 }
-void UThumbnailSubsystem::StartThumbnailProcessing()
+FThumbnailLatencyStats UThumbnailSubsystem::GetLatencyStats() const
 {
-	if (TickDelegateHandle.IsValid())
+	return Service ? Service->GetLatencyStats() : FThumbnailLatencyStats();
+}
+void UThumbnailSubsystem::TrimUnreferencedThumbnails()
+{
+	if (Service)
 	{
-		return;
+		Service->TrimUnreferencedThumbnails();
 	}
-	TickDelegateHandle = FTSTicker::GetCoreTicker().AddTicker(TickDelegate);
-}
\ No newline at end of file
+}
+TArray<FThumbnailDuplicateGroup> UThumbnailSubsystem::GetDuplicateGroups() const
+{
+	return Service ? Service->GetDuplicateGroups() : TArray<FThumbnailDuplicateGroup>();
+}
@@ -0,0 +1,181 @@
+#include "ThumbnailTimeline.h"
+#include "ThumbnailPlugin.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarThumbnailTimelineCapacity(
+	TEXT("Thumbnail.TimelineCapacity"),
+	1024,
+	TEXT("Number of delivered thumbnail requests whose stage timestamps are kept for Thumbnail.DumpTimelines."));
+
+namespace
+{
+	const TCHAR* StageNames[] = {
+		TEXT("Queued"),
+		TEXT("Init"),
+		TEXT("Coalesced"),
+		TEXT("Loaded"),
+		TEXT("Settled"),
+		TEXT("Captured"),
+		TEXT("ReadBack"),
+		TEXT("Delivered")
+	};
+	static_assert(UE_ARRAY_COUNT(StageNames) == (int32)EThumbnailStage::Num, "One name per thumbnail stage.");
+
+	const TCHAR* GetSourceName(EThumbnailResultSource source)
+	{
+		switch (source)
+		{
+		case EThumbnailResultSource::Cache:
+			return TEXT("cache");
+		case EThumbnailResultSource::Downsampled:
+			return TEXT("downsampled");
+		default:
+			return TEXT("rendered");
+		}
+	}
+
+	const TCHAR* GetOutputModeName(EThumbnailOutputMode mode)
+	{
+		switch (mode)
+		{
+		case EThumbnailOutputMode::RenderTarget:
+			return TEXT("RenderTarget");
+		case EThumbnailOutputMode::Pixels:
+			return TEXT("Pixels");
+		default:
+			return TEXT("Texture2D");
+		}
+	}
+
+	double Percentile(const TArray<double>& sorted, double percentile)
+	{
+		const int32 index = FMath::Clamp(FMath::CeilToInt(percentile * sorted.Num()) - 1, 0, sorted.Num() - 1);
+		return sorted[index];
+	}
+
+	void LogPercentiles(const FString& group, const TArray<const FThumbnailTimeline*>& timelines)
+	{
+		UE_LOG(LogThumbnail, Display, TEXT("%s, %d requests (ms)      n      p50      p95      p99"), *group, timelines.Num());
+		TArray<double> durations;
+		auto logRow = [&durations](const TCHAR* name)
+		{
+			if (durations.IsEmpty())
+			{
+				return;
+			}
+			durations.Sort();
+			UE_LOG(LogThumbnail, Display, TEXT("    %-20s %6d %8.2f %8.2f %8.2f"), name, durations.Num(),
+				Percentile(durations, 0.5) * 1000.0, Percentile(durations, 0.95) * 1000.0, Percentile(durations, 0.99) * 1000.0);
+		};
+		// Queued is where every timeline starts, it has no duration of its own.
+		for (int32 stage = (int32)EThumbnailStage::Queued + 1; stage < (int32)EThumbnailStage::Num; stage++)
+		{
+			durations.Reset();
+			for (const FThumbnailTimeline* timeline : timelines)
+			{
+				const double duration = timeline->GetDuration((EThumbnailStage)stage);
+				if (duration >= 0.0)
+				{
+					durations.Add(duration);
+				}
+			}
+			logRow(StageNames[stage]);
+		}
+		durations.Reset();
+		for (const FThumbnailTimeline* timeline : timelines)
+		{
+			durations.Add(timeline->GetTotal());
+		}
+		logRow(TEXT("Total"));
+	}
+}
+
+void FThumbnailTimelineLog::Add(const FThumbnailTimeline& timeline)
+{
+	const int32 capacity = FMath::Max(CVarThumbnailTimelineCapacity.GetValueOnAnyThread(), 1);
+	FScopeLock lock(&Mutex);
+	if (Timelines.Num() > capacity)
+	{
+		// Shrunk at runtime, starting over is simpler than compacting the ring.
+		Timelines.Reset();
+		Next = 0;
+	}
+	else if (Timelines.Num() < capacity && Next != Timelines.Num())
+	{
+		// Grown after the ring wrapped. Put the oldest first so appending keeps the order Dump expects.
+		TArray<FThumbnailTimeline> ordered;
+		ordered.Reserve(capacity);
+		for (int32 i = 0; i < Timelines.Num(); i++)
+		{
+			ordered.Add(MoveTemp(Timelines[(Next + i) % Timelines.Num()]));
+		}
+		Timelines = MoveTemp(ordered);
+		Next = Timelines.Num();
+	}
+	if (Timelines.Num() < capacity)
+	{
+		Timelines.Add(timeline);
+	}
+	else
+	{
+		Timelines[Next] = timeline;
+	}
+	Next = (Next + 1) % capacity;
+}
+
+void FThumbnailTimelineLog::Dump(int32 numRecent) const
+{
+	// Oldest first. While the buffer is filling up Next equals its size, so the same index math applies.
+	TArray<FThumbnailTimeline> timelines;
+	{
+		FScopeLock lock(&Mutex);
+		timelines.Reserve(Timelines.Num());
+		for (int32 i = 0; i < Timelines.Num(); i++)
+		{
+			timelines.Add(Timelines[(Next + i) % Timelines.Num()]);
+		}
+	}
+	if (timelines.IsEmpty())
+	{
+		UE_LOG(LogThumbnail, Display, TEXT("No thumbnail requests delivered yet."));
+		return;
+	}
+
+	const int32 first = FMath::Max(timelines.Num() - FMath::Max(numRecent, 0), 0);
+	UE_LOG(LogThumbnail, Display, TEXT("Last %d of %d thumbnail timelines, ms spent reaching each stage:"), timelines.Num() - first, timelines.Num());
+	for (int32 i = first; i < timelines.Num(); i++)
+	{
+		const FThumbnailTimeline& timeline = timelines[i];
+		FString stages;
+		for (int32 stage = (int32)EThumbnailStage::Queued + 1; stage < (int32)EThumbnailStage::Num; stage++)
+		{
+			const double duration = timeline.GetDuration((EThumbnailStage)stage);
+			stages += duration >= 0.0 ? FString::Printf(TEXT(" %s %.2f"), StageNames[stage], duration * 1000.0) : FString::Printf(TEXT(" %s -"), StageNames[stage]);
+		}
+		UE_LOG(LogThumbnail, Display, TEXT("%8.2f ms %s (%s) %dx%d %s %s:%s"), timeline.GetTotal() * 1000.0, *timeline.Asset.ToString(), *timeline.AssetType.ToString(),
+			timeline.SizeX, timeline.SizeY, GetOutputModeName(timeline.OutputMode), GetSourceName(timeline.Source), *stages);
+	}
+
+	TArray<const FThumbnailTimeline*> all;
+	TMap<FName, TArray<const FThumbnailTimeline*>> byType;
+	TMap<int32, TArray<const FThumbnailTimeline*>> bySize;
+	for (const FThumbnailTimeline& timeline : timelines)
+	{
+		all.Add(&timeline);
+		byType.FindOrAdd(timeline.AssetType).Add(&timeline);
+		// Bucketed by the longest side rounded up to a power of two.
+		bySize.FindOrAdd((int32)FMath::RoundUpToPowerOfTwo((uint32)FMath::Max3(timeline.SizeX, timeline.SizeY, 1))).Add(&timeline);
+	}
+	byType.KeySort(FNameLexicalLess());
+	bySize.KeySort(TLess<int32>());
+
+	LogPercentiles(TEXT("All"), all);
+	for (const TPair<FName, TArray<const FThumbnailTimeline*>>& pair : byType)
+	{
+		LogPercentiles(pair.Key.ToString(), pair.Value);
+	}
+	for (const TPair<int32, TArray<const FThumbnailTimeline*>>& pair : bySize)
+	{
+		LogPercentiles(FString::Printf(TEXT("Up to %d px"), pair.Key), pair.Value);
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ThumbnailRequest.h"
+
+/**
+ * Ring buffer of the timelines of the last Thumbnail.TimelineCapacity delivered requests.
+ * Pixel requests finish on workers, so adding and dumping go through a lock.
+ */
+class FThumbnailTimelineLog
+{
+public:
+	void Add(const FThumbnailTimeline& timeline);
+
+	// Logs the numRecent latest timelines stage by stage, then p50, p95 and p99 of every stage over the whole
+	// buffer, for all requests, per asset type and per size.
+	void Dump(int32 numRecent) const;
+
+private:
+	mutable FCriticalSection Mutex;
+	TArray<FThumbnailTimeline> Timelines;
+	// Slot the next timeline goes into, the oldest one once the buffer is full.
+	int32 Next = 0;
+};
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Engine/Scene.h"
 #include "GeometryCollection/GeometryCollectionComponent.h"
+#include "ShowFlags.h"
+#include "ThumbnailQuality.h"
 #include "RenderActor.generated.h"
 
 class USceneCaptureComponent2D;
 class USpringArmComponent;
+struct FThumbnailPart;
+struct FThumbnailMaterialOverride;
+class UMaterialInstanceDynamic;
 UCLASS()
 class THUMBNAILPLUGIN_API ARenderActor : public AActor
 {
@@ -22,6 +28,8 @@ public:
 	void SetFOV(float FOV);
 	void SetProjection(ECameraProjectionMode::Type projectionMode);
 	ECameraProjectionMode::Type GetProjection();
+	void ApplyQualityProfile(EThumbnailQualityProfile profile);
+	EThumbnailQualityProfile GetQualityProfile() const { return QualityProfile; };
 public:
 
 protected:
@@ -34,6 +42,11 @@ private:
 	UPROPERTY(VisibleDefaultsOnly, Category = "RenderActor")
 	class USceneCaptureComponent2D* Capturer;
 
+	EThumbnailQualityProfile QualityProfile = EThumbnailQualityProfile::Standard;
+	// Capture settings as the component constructed them, restored before every profile is applied.
+	TOptional<FEngineShowFlags> DefaultShowFlags;
+	FPostProcessSettings DefaultPostProcessSettings;
+	float DefaultPostProcessBlendWeight = 1.f;
 
 public:
 
@@ -75,6 +88,25 @@ private:
 	UPROPERTY()
 	TArray<TObjectPtr<UInstancedStaticMeshComponent>> InstancedStaticMesh;
 
+	// Components for composite parts, reused between composites and hidden when unused.
+	UPROPERTY()
+	TArray<TObjectPtr<UStaticMeshComponent>> PartStaticMeshes;
+	UPROPERTY()
+	TArray<TObjectPtr<USkeletalMeshComponent>> PartSkeletalMeshes;
+
+	// Part components in part order, null where a part had no mesh.
+	UPROPERTY()
+	TArray<TObjectPtr<UMeshComponent>> ActivePartComponents;
+
+	uint32 PartsHash = 0;
+	double PartsRadius = 0;
+
+	// Every dynamic instance created for overrides, reused by parent material across variants.
+	UPROPERTY()
+	TArray<TObjectPtr<UMaterialInstanceDynamic>> MaterialInstances;
+
+	uint32 MaterialOverridesHash = 0;
+
 	
 	FName GeometryCollectionName = NAME_None;
 
@@ -86,6 +118,12 @@ public:
 	void SetGeometryCollection(UGeometryCollection* collection);
 	void SetStaticMesh(UStaticMesh* mesh);
 	void SetSkeletalMesh(USkeletalMesh* mesh);
+	// Shows every part at once, centred on their combined bounds.
+	void SetParts(const TArray<FThumbnailPart>& parts, uint32 partsHash);
+	uint32 GetPartsHash() const { return PartsHash; };
+	// Applies on top of the current mesh or composite. Changing the mesh drops them again.
+	void SetMaterialOverrides(const TArray<FThumbnailMaterialOverride>& overrides, uint32 overridesHash);
+	uint32 GetMaterialOverridesHash() const { return MaterialOverridesHash; };
 	UStaticMesh* GetMesh() const;
 	USkeletalMesh* GetSkeletalMesh() const;
 
@@ -94,4 +132,11 @@ public:
 
 protected:
 	virtual void Tick(float DeltaTime) override;
+
+private:
+	void ClearParts();
+	void ClearMaterialOverrides();
+	UMeshComponent* GetOverrideTarget(int32 part) const;
+	template <typename T>
+	T* AcquirePartComponent(TArray<TObjectPtr<T>>& components, int32 index);
 };
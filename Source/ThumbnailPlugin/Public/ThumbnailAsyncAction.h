@@ -6,7 +6,52 @@
 #include "ThumbnailAsyncAction.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnThumbnailFinished, UTexture2D*, ThumbnailTexture);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnThumbnailRenderTargetFinished, UTextureRenderTarget2D*, ThumbnailRenderTarget);
 
+namespace ThumbnailAsyncAction
+{
+	// TSubject is a mesh pointer or a TArray<FThumbnailPart>, anything UThumbnailSubsystem::QueueMeshThumbnail accepts.
+	template <typename TAction, typename TSubject>
+	FThumbnailRequest* QueueThumbnail(const UObject* WorldContext, const TSubject& inMesh, int32 sizeX, int32 sizeY, EThumbnailQualityProfile quality, UThumbnailLightingPreset* lightingPreset, TAction*& outAction)
+	{
+		outAction = nullptr;
+		UWorld* ContextWorld = GEngine->GetWorldFromContextObject(WorldContext, EGetWorldErrorMode::ReturnNull);
+		if (!ensureAlwaysMsgf(IsValid(WorldContext), TEXT("World Context was not valid.")))
+		{
+			return nullptr;
+		}
+		UThumbnailSubsystem* subsystem = ContextWorld->GetGameInstance()->GetSubsystem<UThumbnailSubsystem>();
+		if (!ensureAlwaysMsgf(IsValid(subsystem), TEXT("Thumbnail subsystem was not valid.")))
+		{
+			return nullptr;
+		}
+		FThumbnailRequest* entry = subsystem->QueueMeshThumbnail(inMesh);
+		if (!entry)
+		{
+			return nullptr;
+		}
+		entry->SizeX = sizeX;
+		entry->SizeY = sizeY;
+		entry->QualityProfile = quality;
+		if (lightingPreset)
+		{
+			entry->LightingPreset = lightingPreset;
+		}
+		outAction = NewObject<TAction>();
+		outAction->ContextWorld = ContextWorld;
+		outAction->Subsystem = subsystem;
+		outAction->RequestHandle = entry->Handle;
+		outAction->RegisterWithGameInstance(ContextWorld->GetGameInstance());
+		return entry;
+	}
+}
+
+/**
+ * Delivers a thumbnail texture to Blueprint. No FThumbnailHandle is held for it, so the cache may evict it while it is
+ * displayed and it stops counting against the memory budget. Asking for it again while it is still alive returns the
+ * same texture. Use UThumbnailSubsystem::PinThumbnail to keep it resident.
+ * The action is released after the final delivery, or when cancelled.
+ */
 UCLASS()
 class THUMBNAILPLUGIN_API UThumbnailAsyncAction : public UCancellableAsyncAction
 {
@@ -14,15 +59,20 @@ class THUMBNAILPLUGIN_API UThumbnailAsyncAction : public UCancellableAsyncAction
 
 public:
 
-	UFUNCTION(BlueprintCallable, DisplayName = "Get Static Mesh Thumbnail", meta = (WorldContext = "WorldContext", BlueprintInternalUseOnly = "true"))
-	static UThumbnailAsyncAction* GetStaticMeshThumbnail(const UObject* WorldContext, UStaticMesh* inMesh, int32 sizeX = 256, int32 sizeY = 256);
-	UFUNCTION(BlueprintCallable, DisplayName = "Get Skeletal Mesh Thumbnail", meta = (WorldContext = "WorldContext", BlueprintInternalUseOnly = "true"))
-	static UThumbnailAsyncAction* GetSkeletalMeshThumbnail(const UObject* WorldContext, USkeletalMesh* inMesh, int32 sizeX = 256, int32 sizeY = 256);
+	UFUNCTION(BlueprintCallable, DisplayName = "Get Static Mesh Thumbnail", meta = (WorldContext = "WorldContext", BlueprintInternalUseOnly = "true", AutoCreateRefTerm = "materialOverrides,postProcess"))
+	static UThumbnailAsyncAction* GetStaticMeshThumbnail(const UObject* WorldContext, UStaticMesh* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, const FThumbnailPostProcess& postProcess, int32 sizeX = 256, int32 sizeY = 256, EThumbnailQualityProfile quality = EThumbnailQualityProfile::Standard, UThumbnailLightingPreset* lightingPreset = nullptr, int32 priority = 0, bool bProgressive = false);
+	UFUNCTION(BlueprintCallable, DisplayName = "Get Skeletal Mesh Thumbnail", meta = (WorldContext = "WorldContext", BlueprintInternalUseOnly = "true", AutoCreateRefTerm = "materialOverrides,postProcess"))
+	static UThumbnailAsyncAction* GetSkeletalMeshThumbnail(const UObject* WorldContext, USkeletalMesh* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, const FThumbnailPostProcess& postProcess, int32 sizeX = 256, int32 sizeY = 256, EThumbnailQualityProfile quality = EThumbnailQualityProfile::Standard, UThumbnailLightingPreset* lightingPreset = nullptr, int32 priority = 0, bool bProgressive = false);
+	// Renders every part together in one capture, e.g. a modular character with its armor and a socketed weapon.
+	UFUNCTION(BlueprintCallable, DisplayName = "Get Composite Thumbnail", meta = (WorldContext = "WorldContext", BlueprintInternalUseOnly = "true", AutoCreateRefTerm = "materialOverrides,postProcess"))
+	static UThumbnailAsyncAction* GetCompositeThumbnail(const UObject* WorldContext, const TArray<FThumbnailPart>& parts, const TArray<FThumbnailMaterialOverride>& materialOverrides, const FThumbnailPostProcess& postProcess, int32 sizeX = 256, int32 sizeY = 256, EThumbnailQualityProfile quality = EThumbnailQualityProfile::Standard, UThumbnailLightingPreset* lightingPreset = nullptr, int32 priority = 0, bool bProgressive = false);
 
 	virtual void Activate() override;
 	virtual void Cancel() override;
 
 	void OnThumbnailComplete(UTexture2D* inTexture);
+	// Only fired with the final texture, never with a progressive placeholder.
+	void OnThumbnailFinal(const FThumbnailHandle& handle);
 
 	virtual UWorld* GetWorld() const override
 	{
@@ -30,39 +80,86 @@ public:
 	}
 
 private:
-	template <typename T>
-	static UThumbnailAsyncAction* GetThumbnail(const UObject* WorldContext, T* inMesh, int32 sizeX, int32 sizeY)
+	template <typename TSubject>
+	static UThumbnailAsyncAction* GetThumbnail(const UObject* WorldContext, const TSubject& inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, const FThumbnailPostProcess& postProcess, int32 sizeX, int32 sizeY, EThumbnailQualityProfile quality, UThumbnailLightingPreset* lightingPreset, int32 priority, bool bProgressive)
 	{
-		UWorld* ContextWorld = GEngine->GetWorldFromContextObject(WorldContext, EGetWorldErrorMode::ReturnNull);
-		if (!ensureAlwaysMsgf(IsValid(WorldContext), TEXT("World Context was not valid.")))
-		{
-			return nullptr;
-		}
-		UThumbnailSubsystem* subsystem = ContextWorld->GetGameInstance()->GetSubsystem<UThumbnailSubsystem>();
-		if (!ensureAlwaysMsgf(IsValid(subsystem), TEXT("Thumbnail subsystem was not valid.")))
+		UThumbnailAsyncAction* NewAction = nullptr;
+		FThumbnailRequest* entry = ThumbnailAsyncAction::QueueThumbnail(WorldContext, inMesh, sizeX, sizeY, quality, lightingPreset, NewAction);
+		if (!entry)
 		{
 			return nullptr;
 		}
-		UThumbnailQueuedEntry* entry = subsystem->QueueMeshThumbnail(inMesh);
+		entry->Priority = priority;
+		entry->bProgressive = bProgressive;
+		entry->MaterialOverrides = materialOverrides;
+		entry->PostProcess = postProcess;
+		entry->OnComplete.BindUObject(NewAction, &UThumbnailAsyncAction::OnThumbnailComplete);
+		entry->OnHandleComplete.BindUObject(NewAction, &UThumbnailAsyncAction::OnThumbnailFinal);
+
+		return NewAction;
+	}
+
+public:
+	// Fires twice for progressive requests, first with the placeholder and then with the full render.
+	UPROPERTY(BlueprintAssignable)
+	FOnThumbnailFinished ThumbnailCompleteEvent;
+
+	TWeakObjectPtr<UWorld> ContextWorld = nullptr;
+	TWeakObjectPtr<UThumbnailSubsystem> Subsystem = nullptr;
+	FThumbnailRequestHandle RequestHandle;
+
+};
+
+/**
+ * Same as UThumbnailAsyncAction but delivers a pooled render target that UMG brushes can draw directly.
+ * No CPU side copy of the pixels is made. Hand the render target back with UThumbnailSubsystem::ReleaseRenderTarget
+ * once it is no longer displayed. The action is released after delivery, or when cancelled.
+ */
+UCLASS()
+class THUMBNAILPLUGIN_API UThumbnailRenderTargetAsyncAction : public UCancellableAsyncAction
+{
+	GENERATED_BODY()
+
+public:
+
+	UFUNCTION(BlueprintCallable, DisplayName = "Get Static Mesh Thumbnail (Render Target)", meta = (WorldContext = "WorldContext", BlueprintInternalUseOnly = "true", AutoCreateRefTerm = "materialOverrides"))
+	static UThumbnailRenderTargetAsyncAction* GetStaticMeshThumbnailRenderTarget(const UObject* WorldContext, UStaticMesh* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, int32 sizeX = 256, int32 sizeY = 256, EThumbnailQualityProfile quality = EThumbnailQualityProfile::Standard, UThumbnailLightingPreset* lightingPreset = nullptr);
+	UFUNCTION(BlueprintCallable, DisplayName = "Get Skeletal Mesh Thumbnail (Render Target)", meta = (WorldContext = "WorldContext", BlueprintInternalUseOnly = "true", AutoCreateRefTerm = "materialOverrides"))
+	static UThumbnailRenderTargetAsyncAction* GetSkeletalMeshThumbnailRenderTarget(const UObject* WorldContext, USkeletalMesh* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, int32 sizeX = 256, int32 sizeY = 256, EThumbnailQualityProfile quality = EThumbnailQualityProfile::Standard, UThumbnailLightingPreset* lightingPreset = nullptr);
+
+	virtual void Activate() override;
+	virtual void Cancel() override;
+
+	void OnThumbnailComplete(UTextureRenderTarget2D* inRenderTarget);
+
+	virtual UWorld* GetWorld() const override
+	{
+		return ContextWorld.IsValid() ? ContextWorld.Get() : nullptr;
+	}
+
+private:
+	template <typename T>
+	static UThumbnailRenderTargetAsyncAction* GetThumbnail(const UObject* WorldContext, T* inMesh, const TArray<FThumbnailMaterialOverride>& materialOverrides, int32 sizeX, int32 sizeY, EThumbnailQualityProfile quality, UThumbnailLightingPreset* lightingPreset)
+	{
+		UThumbnailRenderTargetAsyncAction* NewAction = nullptr;
+		FThumbnailRequest* entry = ThumbnailAsyncAction::QueueThumbnail(WorldContext, inMesh, sizeX, sizeY, quality, lightingPreset, NewAction);
 		if (!entry)
 		{
 			return nullptr;
 		}
-		entry->SizeX = sizeX;
-		entry->SizeY = sizeY;
-		UThumbnailAsyncAction* NewAction = NewObject<UThumbnailAsyncAction>();
-		NewAction->ContextWorld = ContextWorld;
-		NewAction->RegisterWithGameInstance(ContextWorld->GetGameInstance());
-
-		entry->OnComplete.BindUObject(NewAction, &UThumbnailAsyncAction::OnThumbnailComplete);
+		entry->OutputMode = EThumbnailOutputMode::RenderTarget;
+		entry->MaterialOverrides = materialOverrides;
+		entry->OnRenderTargetComplete.BindUObject(NewAction, &UThumbnailRenderTargetAsyncAction::OnThumbnailComplete);
 
 		return NewAction;
 	}
 
 public:
 	UPROPERTY(BlueprintAssignable)
-	FOnThumbnailFinished ThumbnailCompleteEvent;
+	FOnThumbnailRenderTargetFinished ThumbnailCompleteEvent;
 
 	TWeakObjectPtr<UWorld> ContextWorld = nullptr;
+	TWeakObjectPtr<UThumbnailSubsystem> Subsystem = nullptr;
+	FThumbnailRequestHandle RequestHandle;
 
 };
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/SoftObjectPath.h"
+#include "ThumbnailQuality.h"
+#if WITH_EDITORONLY_DATA
+#include "IO/IoHash.h"
+#endif
+#include "ThumbnailCache.generated.h"
+
+class UTexture;
+class UPackage;
+
+struct FThumbnailCacheKey
+{
+	TObjectKey<UObject> Asset;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	EThumbnailQualityProfile Quality = EThumbnailQualityProfile::Standard;
+	TObjectKey<UObject> LightingPreset;
+	// Non zero for composite requests, Asset is then the first part.
+	uint32 PartsHash = 0;
+	// Non zero when material overrides are applied.
+	uint32 OverridesHash = 0;
+	// Non zero when CPU post processing is applied.
+	uint32 PostProcessHash = 0;
+
+	// Same mesh, framing, lighting and size. Only the material overrides and CPU post processing may differ.
+	bool IsVariantOf(const FThumbnailCacheKey& other) const
+	{
+		return Asset == other.Asset && Quality == other.Quality && LightingPreset == other.LightingPreset && PartsHash == other.PartsHash
+			&& SizeX == other.SizeX && SizeY == other.SizeY;
+	}
+	// Everything but the size matches, so one can be downsampled into the other.
+	bool IsSameRender(const FThumbnailCacheKey& other) const
+	{
+		return Asset == other.Asset && Quality == other.Quality && LightingPreset == other.LightingPreset && PartsHash == other.PartsHash
+			&& OverridesHash == other.OverridesHash && PostProcessHash == other.PostProcessHash;
+	}
+	bool operator==(const FThumbnailCacheKey& other) const
+	{
+		return IsSameRender(other) && SizeX == other.SizeX && SizeY == other.SizeY;
+	}
+	friend uint32 GetTypeHash(const FThumbnailCacheKey& key)
+	{
+		uint32 hash = HashCombine(GetTypeHash(key.Asset), HashCombine(GetTypeHash(key.SizeX), GetTypeHash(key.SizeY)));
+		hash = HashCombine(hash, GetTypeHash(key.Quality));
+		hash = HashCombine(hash, GetTypeHash(key.LightingPreset));
+		hash = HashCombine(hash, key.PartsHash);
+		hash = HashCombine(hash, key.OverridesHash);
+		return HashCombine(hash, key.PostProcessHash);
+	}
+};
+
+/** A package a thumbnail was rendered from: the mesh, its materials, their textures and the lighting preset. */
+struct FThumbnailDependency
+{
+	FName PackageName;
+	// Goes stale, or stops being the package found under PackageName, once the package is reloaded.
+	TWeakObjectPtr<UPackage> Package;
+#if WITH_EDITORONLY_DATA
+	// Hash of the package as last saved, changes on save and reimport.
+	FIoHash SavedHash;
+#endif
+
+	// False once the package was reloaded or saved with different content.
+	bool IsCurrent() const;
+};
+
+// Hashes of a produced image, computed on the worker that read it back.
+struct FThumbnailImageHash
+{
+	// Zero when not hashed, such records never share storage.
+	uint64 Exact = 0;
+	uint64 Perceptual = 0;
+};
+
+struct FThumbnailRecord
+{
+	FThumbnailCacheKey Key;
+	TObjectPtr<UTexture> Texture = nullptr;
+	// Tightly packed float16 RGBA copy of the texture, kept so smaller sizes can be downsampled from it.
+	TSharedPtr<const TArray64<uint8>, ESPMode::ThreadSafe> Pixels;
+	int64 Bytes = 0;
+	double LastUsedTime = 0;
+	TArray<FThumbnailDependency> Dependencies;
+	// Records with the same exact hash share Texture, Pixels and their memory.
+	FThumbnailImageHash Hash;
+};
+
+/**
+ * Reference counted handle to a cached thumbnail. While any handle is alive the thumbnail
+ * will not be evicted from the cache. Copying the handle (including in Blueprint) adds a reference.
+ */
+USTRUCT(BlueprintType)
+struct THUMBNAILPLUGIN_API FThumbnailHandle
+{
+	GENERATED_BODY()
+
+	FThumbnailHandle() {};
+	FThumbnailHandle(TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> inRecord) : Record(MoveTemp(inRecord)) {};
+
+	bool IsValid() const { return Record.IsValid() && Record->Texture != nullptr; };
+	UTexture* GetTexture() const { return Record.IsValid() ? Record->Texture.Get() : nullptr; };
+	void Reset() { Record.Reset(); };
+
+private:
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> Record;
+};
+
+USTRUCT(BlueprintType)
+struct THUMBNAILPLUGIN_API FThumbnailMemoryStats
+{
+	GENERATED_BODY()
+
+	// Bytes held by cached thumbnails and pooled render targets.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int64 TotalBytes = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 Count = 0;
+	// Thumbnails pinned by at least one handle or render targets still handed out.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 ReferencedCount = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int64 BudgetBytes = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 Evictions = 0;
+	// Requests served straight from the cache.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 CacheHits = 0;
+	// Requests served by downsampling a larger cached render of the same mesh.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 DownsampleHits = 0;
+	// Scene renders that were avoided by the two above.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 RerendersAvoided = 0;
+	// Thumbnails dropped because an asset they were rendered from changed.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 Invalidations = 0;
+	// Cached thumbnails whose pixels matched another one and that share its texture instead of holding their own.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 SharedCount = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int64 SharedBytesSaved = 0;
+};
+
+/** Assets whose cached thumbnails look the same. Candidates for merging or cleaning up. */
+USTRUCT(BlueprintType)
+struct THUMBNAILPLUGIN_API FThumbnailDuplicateGroup
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	TArray<FSoftObjectPath> Assets;
+	// Pixel identical renders. Otherwise the renders only matched on their perceptual hash.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	bool bExact = false;
+	// Memory the cache saves by sharing one texture between the group, exact groups only.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int64 SharedBytesSaved = 0;
+};
+
+/** Owns produced thumbnail textures, tracks their memory and evicts the least recently used unreferenced ones. */
+class THUMBNAILPLUGIN_API FThumbnailCache : public FGCObject
+{
+public:
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> Find(const FThumbnailCacheKey& key);
+	FThumbnailHandle FindByTexture(const UTexture* texture) const;
+	// Smallest cached render with retained pixels that key can be downsampled from.
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> FindDownsampleSource(const FThumbnailCacheKey& key);
+	// Texture of a cached image with the same exact hash, to be reused instead of creating another.
+	UTexture* FindIdentical(uint64 exactHash) const;
+	// A record whose hash matches a cached image shares that image's texture and pixels, texture and pixels passed in are dropped.
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> Add(const FThumbnailCacheKey& key, UTexture* texture, int64 bytes, TSharedPtr<const TArray64<uint8>, ESPMode::ThreadSafe> pixels = nullptr,
+		TArray<FThumbnailDependency>&& dependencies = TArray<FThumbnailDependency>(), const FThumbnailImageHash& hash = FThumbnailImageHash());
+	void Remove(const FThumbnailCacheKey& key);
+	void Empty();
+
+	// Evicts unreferenced thumbnails, oldest first, until the cache fits in budgetBytes.
+	void EnforceBudget(int64 budgetBytes);
+	// Evicts every unreferenced thumbnail. Returns the number evicted.
+	int32 TrimUnreferenced();
+
+	// Drops every thumbnail rendered from the package, pinned or not. Returns the number dropped.
+	int32 InvalidatePackage(FName packageName);
+	// Drops every thumbnail with a dependency that is no longer current. Returns the number dropped.
+	int32 ValidateDependencies();
+
+	// Groups of distinct assets with identical renders, then groups whose renders with the same quality, lighting and
+	// post processing are within maxPerceptualDistance bits of each other. Composite and material override renders are left out.
+	TArray<FThumbnailDuplicateGroup> GetDuplicateGroups(int32 maxPerceptualDistance) const;
+
+	void AccumulateStats(FThumbnailMemoryStats& stats) const;
+	void RecordHit() { CacheHits++; };
+	void RecordDownsampleHit() { DownsampleHits++; };
+
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
+
+private:
+	static bool IsReferenced(const TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>& record) { return record.GetSharedReferenceCount() > 1; };
+	void Evict(const FThumbnailCacheKey& key);
+	// Adds a released record back while its texture is still alive.
+	TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe> Revive(const FThumbnailCacheKey& key);
+
+	TMap<FThumbnailCacheKey, TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>> Records;
+	// Records replaced or removed while handles still pointed at them. Their textures stay referenced until the last handle goes away.
+	TArray<TWeakPtr<FThumbnailRecord, ESPMode::ThreadSafe>> Orphans;
+	// Records evicted without a handle, remembered until their texture is garbage collected. Textures delivered to
+	// Blueprint or UMG are held without a handle, a request for one still on screen takes it back instead of rendering a copy.
+	struct FReleasedRecord
+	{
+		TWeakObjectPtr<UTexture> Texture;
+		int64 Bytes = 0;
+		TArray<FThumbnailDependency> Dependencies;
+		FThumbnailImageHash Hash;
+	};
+	TMap<FThumbnailCacheKey, FReleasedRecord> Released;
+	// Storage of the records sharing one exact hash. Its memory is counted once, when the first of them is added.
+	struct FSharedImage
+	{
+		// Kept alive by the records.
+		UTexture* Texture = nullptr;
+		TSharedPtr<const TArray64<uint8>, ESPMode::ThreadSafe> Pixels;
+		int64 Bytes = 0;
+		int32 NumRecords = 0;
+	};
+	TMap<uint64, FSharedImage> Images;
+	// How many cached records depend on each package, lets unrelated change notifications return straight away.
+	TMap<FName, int32> DependencyCounts;
+	int64 TotalBytes = 0;
+	int32 Invalidations = 0;
+	int32 Evictions = 0;
+	int32 CacheHits = 0;
+	int32 DownsampleHits = 0;
+};
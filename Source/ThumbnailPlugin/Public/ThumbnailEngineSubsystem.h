@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Containers/Queue.h"
+#include "ThumbnailPixels.h"
+#include "ThumbnailCache.h"
+#include "ThumbnailQuality.h"
+#include "ThumbnailRequest.h"
+#include "ThumbnailEngineSubsystem.generated.h"
+
+class FThumbnailScene;
+class UStaticMesh;
+class USkeletalMesh;
+class UTextureRenderTarget2D;
+class UGeometryCollection;
+class FThumbnailReadbackQueue;
+class FThumbnailCaptureScheduler;
+class FThumbnailTimelineLog;
+class UThumbnailLightingPreset;
+class FPackageReloadedEvent;
+enum class EPackageReloadPhase : uint8;
+
+// Float16 pixels read back for a Texture2D entry, waiting to be turned into a texture on the game thread.
+struct FThumbnailCompletedPixels
+{
+	FThumbnailRequestHandle Entry;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	TArray64<uint8> Pixels;
+	// Not computed for placeholders.
+	FThumbnailImageHash Hash;
+	// Zero for downsampled results, which are never captured.
+	double CapturedTime = 0.0;
+	// Progressive pass result, delivered without touching the cache or the entry's lifetime.
+	bool bPlaceholder = false;
+};
+
+/**
+ * Owns the single preview world, render target pools and thumbnail cache shared by every game instance, so
+ * PIE clients and split-screen players reuse each other's renders and memory is only counted once.
+ * Game code talks to it through the per game instance UThumbnailSubsystem.
+ */
+UCLASS()
+class THUMBNAILPLUGIN_API UThumbnailEngineSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+	FThumbnailScene* PreviewScene = nullptr;
+	FThumbnailReadbackQueue* ReadbackQueue = nullptr;
+	FThumbnailCache* Cache = nullptr;
+	FThumbnailCaptureScheduler* CaptureScheduler = nullptr;
+	// Owns every request below and keeps their assets alive.
+	FThumbnailRequestPool* RequestPool = nullptr;
+
+	FThumbnailRequest* CurrentEntry = nullptr;
+	TArray<FThumbnailRequest*> Queue;
+	// Entries whose capture is done but whose pixels are still on their way back from the GPU.
+	TArray<FThumbnailRequest*> AwaitingReadback;
+	// Entries that will be downsampled from a larger render of the same mesh that is still in flight.
+	TArray<FThumbnailRequest*> WaitingForSource;
+	// Requests handed in from any thread, moved into the pool at the start of each tick.
+	TQueue<FThumbnailSubmission, EQueueMode::Mpsc> PendingSubmissions;
+	// Owners passed to CancelRequests whose submissions are dropped when drained. Game thread only.
+	TSet<FObjectKey> CancelledOwners;
+	TSharedRef<TQueue<FThumbnailCompletedPixels, EQueueMode::Mpsc>, ESPMode::ThreadSafe> CompletedPixels = MakeShared<TQueue<FThumbnailCompletedPixels, EQueueMode::Mpsc>, ESPMode::ThreadSafe>();
+	UPROPERTY()
+	TObjectPtr<UTextureRenderTarget2D> RenderTarget = nullptr;
+	// Tiny targets for progressive placeholder captures, one per size.
+	UPROPERTY()
+	TMap<FIntPoint, TObjectPtr<UTextureRenderTarget2D>> PlaceholderRenderTargets;
+	UPROPERTY()
+	TObjectPtr<UThumbnailLightingPreset> DefaultLightingPreset = nullptr;
+	FVector2D RenderTargetSize = FVector2D(128, 128);
+	// What the preview scene currently shows, so material variants of it can skip reframing and relighting.
+	FThumbnailCacheKey SceneKey;
+	// Packages behind what the preview scene currently shows. A change to one of them drops the scene's mesh and sky lights.
+	TArray<FThumbnailDependency> SceneDependencies;
+
+	// Every render target handed out in RenderTarget output mode, in use or not.
+	UPROPERTY()
+	TArray<TObjectPtr<UTextureRenderTarget2D>> OutputRenderTargets;
+	// Subset of OutputRenderTargets that has been released back to the pool.
+	UPROPERTY()
+	TArray<TObjectPtr<UTextureRenderTarget2D>> FreeRenderTargets;
+
+	FTickerDelegate					TickDelegate;
+
+	FTSTicker::FDelegateHandle		TickDelegateHandle;
+	// Guards TickDelegateHandle, SubmitThumbnail can start the ticker from any thread.
+	FCriticalSection				TickerMutex;
+
+	FDelegateHandle					MemoryTrimDelegateHandle;
+	FDelegateHandle					ObjectPropertyChangedHandle;
+	FDelegateHandle					PackageReloadedHandle;
+	FDelegateHandle					ReloadCompleteHandle;
+
+	FThumbnailLatencyStats LatencyStats;
+	// Shared with the workers that deliver pixels.
+	TSharedPtr<FThumbnailTimelineLog, ESPMode::ThreadSafe> TimelineLog;
+	int32 NumFirstIcons = 0;
+	double TotalTimeToFirstIcon = 0.0;
+	double TotalTimeToFinal = 0.0;
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// The returned request is owned by the subsystem. Configure it straight away, it is recycled once completed.
+	// Game code should go through UThumbnailSubsystem, which tags requests with their game instance.
+	FThumbnailRequest* QueueMeshThumbnail(UStaticMesh* mesh);
+	FThumbnailRequest* QueueMeshThumbnail(USkeletalMesh* mesh);
+	FThumbnailRequest* QueueMeshThumbnail(UGeometryCollection* collection);
+	FThumbnailRequest* QueueMeshThumbnail(const TArray<FThumbnailPart>& parts);
+	// Thread safe. The request is picked up on the next tick, the subsystem must outlive the call.
+	// Its callbacks never fire if its owner is cancelled or destroyed first.
+	void SubmitThumbnail(FThumbnailSubmission&& submission);
+	bool ThumbnailTick(float DeltaTime);
+	// Drops queued and submitted requests of a game instance that is going away. Renders already in flight still finish and
+	// land in the cache, they just no longer call back. Callbacks of cancelled requests never fire, including
+	// OnPixelsComplete, so a worker thread must not block waiting on one for an owner that may be cancelled.
+	void CancelRequests(FObjectKey owner);
+	// Drops one request if it has not started rendering, otherwise lets it finish without calling back. Stale handles are ignored.
+	void CancelRequest(const FThumbnailRequestHandle& handle);
+
+	// Returns a render target delivered in RenderTarget output mode to the pool.
+	void ReleaseRenderTarget(UTextureRenderTarget2D* renderTarget);
+
+	// Pins a texture delivered by this subsystem so it is not evicted while the handle is alive.
+	FThumbnailHandle PinThumbnail(UTexture2D* texture);
+
+	FThumbnailMemoryStats GetMemoryStats() const;
+
+	// Lighting used by requests that do not name a preset. Null uses the live sky atmosphere rig. Shared by all game instances.
+	void SetDefaultLightingPreset(UThumbnailLightingPreset* preset);
+
+	FThumbnailLatencyStats GetLatencyStats() const;
+	// Logs the stage timestamps of the numRecent latest requests and p50/p95/p99 per stage, asset type and size.
+	void DumpTimelines(int32 numRecent) const;
+
+	// Drops every thumbnail that is not pinned by a handle and every pooled render target not handed out.
+	void TrimUnreferencedThumbnails();
+
+	// Drops cached thumbnails whose packages were reloaded or saved with different content since they were rendered.
+	// Runs whenever the preview scene starts up and after hot reload or live coding. Returns the number dropped.
+	int32 ValidateCache();
+
+	// Distinct assets with identical or, per Thumbnail.PerceptualDuplicateDistance, near identical cached thumbnails.
+	TArray<FThumbnailDuplicateGroup> GetDuplicateGroups() const;
+
+	// Nothing queued, rendering or being read back and the preview world has been torn down.
+	bool IsIdle() const;
+	// Pooled requests not yet freed, queued, in flight or waiting on a readback.
+	int32 GetNumRequestsInUse() const;
+	// Scene captures submitted through the capture scheduler since startup, settle frames and placeholders alike.
+	int32 GetNumCaptures() const;
+
+private:
+	FThumbnailRequest* QueueThumbnail();
+	void DoInitState();
+	void DoProcessingState();
+	void DoCompletedState();
+	void DrainSubmissions();
+	FThumbnailRequest* PopNextEntry();
+	// Submits through the capture scheduler, returns the number of captures it used out of maxCaptures.
+	int32 RenderPlaceholders(int32 maxCaptures);
+	void RecordFirstIcon(FThumbnailRequest* entry);
+	void RecordFinal(FThumbnailRequest* entry);
+	// Stamps Delivered and moves the timeline into the log. Safe from any thread.
+	static void FinishTimeline(FThumbnailTimeline& timeline, FThumbnailTimelineLog& log);
+
+	// Drops everything rendered from the package, cached or in flight, so it is rendered again on next use.
+	void InvalidatePackage(FName packageName);
+#if WITH_EDITOR
+	void OnObjectPropertyChanged(UObject* object, struct FPropertyChangedEvent& event);
+#endif
+	void OnPackageReloaded(EPackageReloadPhase phase, FPackageReloadedEvent* event);
+	void OnReloadComplete(EReloadCompleteReason reason);
+
+	void SetPreviewAsset(const FThumbnailRequest* entry);
+	void EnqueueTextureReadback(FThumbnailRequest* entry, UTextureRenderTarget2D* target, bool bPlaceholder = false);
+	void DrainCompletedPixels();
+	void EnqueueDownsample(const TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>& source);
+	bool CanDownsampleFrom(const FThumbnailRequest* source, const FThumbnailRequest* dest) const;
+	bool WaitForLargerRender();
+	void ResumeWaitingForSource(const UObject* asset);
+	// Requeues parked entries whose source is no longer being rendered or read back.
+	void ResumeWaitingWithoutSource();
+	UTexture2D* CreateThumbnailTexture(int32 sizeX, int32 sizeY, const uint8* float16Pixels);
+	void CompleteFromCache(const TSharedPtr<FThumbnailRecord, ESPMode::ThreadSafe>& record);
+	void DeliverTexture(FThumbnailRequest* entry, const FThumbnailHandle& handle);
+	void EnforceMemoryBudget();
+	int64 GetRenderTargetBytes(UTextureRenderTarget2D* target) const;
+	UTextureRenderTarget2D* CopyToPooledRenderTarget();
+	UTextureRenderTarget2D* AcquireRenderTarget(int32 sizeX, int32 sizeY);
+
+	// Keeps ticking when submissions are pending unless forced.
+	void EndThumbnailProcessing(bool bForce = false);
+	void StartThumbnailProcessing();
+};
+
+
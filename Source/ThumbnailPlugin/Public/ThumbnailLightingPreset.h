@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ThumbnailLightingPreset.generated.h"
+
+class UTextureCube;
+
+/**
+ * Fixed lighting for the thumbnail scene. The sky light is fed from a pre-captured cubemap instead of a live
+ * sky atmosphere capture, so the preset is only filtered once and switching between presets costs nothing.
+ */
+UCLASS(BlueprintType)
+class THUMBNAILPLUGIN_API UThumbnailLightingPreset : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Sky")
+	TObjectPtr<UTextureCube> SkyCubemap = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Sky")
+	float SkyIntensity = 2.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Sky")
+	FLinearColor SkyColor = FLinearColor::White;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Directional Light")
+	FRotator DirectionalLightRotation = FRotator(-45, 180, 0);
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Directional Light")
+	float DirectionalLightIntensity = 5.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Directional Light")
+	FLinearColor DirectionalLightColor = FLinearColor::White;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Directional Light")
+	bool bCastShadows = true;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EThumbnailPixelFormat : uint8
+{
+	BGRA8,
+	RGBA8,
+	RGBA16F,
+	RGBA32F
+};
+
+enum class EThumbnailImageEncoding : uint8
+{
+	None,
+	PNG,
+	JPEG
+};
+
+/** How a thumbnail should be handed back as raw pixels. */
+struct THUMBNAILPLUGIN_API FThumbnailPixelRequest
+{
+	EThumbnailPixelFormat Format = EThumbnailPixelFormat::BGRA8;
+
+	// Applies to the 8 bit formats only, float formats are always linear.
+	bool bSRGB = true;
+
+	// Encoding is done on the worker thread after conversion. Encoded images are always 8 bit.
+	EThumbnailImageEncoding Encoding = EThumbnailImageEncoding::None;
+	int32 Quality = 85;
+
+	// Optional caller owned buffer. Must hold SizeX * SizeY * GetBytesPerPixel(Format) bytes and stay
+	// alive until the completion delegate has run. When empty a pooled buffer is used instead.
+	TArrayView<uint8> Destination;
+
+	static int32 GetBytesPerPixel(EThumbnailPixelFormat format);
+};
+
+/** Result of a pixel request. Only valid for the duration of the completion delegate. */
+struct THUMBNAILPLUGIN_API FThumbnailPixels
+{
+	bool bSuccess = false;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	EThumbnailPixelFormat Format = EThumbnailPixelFormat::BGRA8;
+
+	// Tightly packed rows, no pitch padding.
+	TArrayView<const uint8> Pixels;
+
+	// Compressed image when an encoding was requested.
+	TArrayView<const uint8> Encoded;
+
+	// When the GPU was found done with the capture, in FPlatformTime::Seconds.
+	double CapturedTime = 0.0;
+};
+
+/** Called on a worker thread once the pixels are ready, unless the request asked for the game thread. */
+DECLARE_DELEGATE_OneParam(FOnThumbnailPixels, const FThumbnailPixels&);
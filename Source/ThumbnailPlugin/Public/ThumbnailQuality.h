@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ThumbnailQuality.generated.h"
+
+UENUM(BlueprintType)
+enum class EThumbnailQualityProfile : uint8
+{
+	// Unlit scene color, no post processing, no lighting capture. Done after a single capture.
+	Fast,
+	// Full deferred pipeline with the default show flags.
+	Standard,
+	// Standard with extra settle captures so temporal effects fully converge.
+	High
+};
+
+namespace ThumbnailQuality
+{
+	// Number of captures rendered before the result is read.
+	inline int32 GetSettleFrames(EThumbnailQualityProfile profile)
+	{
+		switch (profile)
+		{
+		case EThumbnailQualityProfile::Fast:
+			return 1;
+		case EThumbnailQualityProfile::High:
+			return 24;
+		default:
+			return 12;
+		}
+	}
+
+	// Captures needed when only materials changed since the previous request. Exposure has already converged on the
+	// same mesh and lighting, only temporal anti aliasing has to catch up with the new surface.
+	inline int32 GetVariantSettleFrames(EThumbnailQualityProfile profile)
+	{
+		switch (profile)
+		{
+		case EThumbnailQualityProfile::Fast:
+			return 1;
+		case EThumbnailQualityProfile::High:
+			return 8;
+		default:
+			return 4;
+		}
+	}
+
+	inline bool UsesLighting(EThumbnailQualityProfile profile)
+	{
+		return profile != EThumbnailQualityProfile::Fast;
+	}
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/StrongObjectPtr.h"
+#include "ThumbnailPixels.h"
+#include "ThumbnailCache.h"
+#include "ThumbnailQuality.h"
+#include "ThumbnailRequest.generated.h"
+
+class UStaticMesh;
+class USkeletalMesh;
+class UTexture2D;
+class UTextureRenderTarget2D;
+class UGeometryCollection;
+class UThumbnailLightingPreset;
+class UMaterialInterface;
+
+enum EJPBThumbnailRenderState
+{
+	ThumbnailRenderState_Init,
+	ThumbnailRenderState_Processing,
+	ThumbnailRenderState_Completed
+};
+
+UENUM(BlueprintType)
+enum class EThumbnailOutputMode : uint8
+{
+	// CPU backed UTexture2D built from the render target. Costs a readback.
+	Texture2D,
+	// GPU copy into a pooled render target. No CPU data is produced.
+	RenderTarget,
+	// Raw pixels delivered on a worker thread through OnPixelsComplete. C++ only.
+	Pixels UMETA(Hidden)
+};
+
+enum class EThumbnailCallbackThread : uint8
+{
+	// Game thread for textures and render targets, a worker for pixels.
+	Default,
+	GameThread,
+	// Any task graph worker. Delivered straight away when the result is already produced off the game thread.
+	AnyThread
+};
+
+/** Time from queuing to the first texture shown and to the final render, in seconds. Texture2D and RenderTarget requests only. */
+USTRUCT(BlueprintType)
+struct THUMBNAILPLUGIN_API FThumbnailLatencyStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 Placeholders = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	int32 Completed = 0;
+	// A placeholder when one arrived first, the final render otherwise.
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	float AverageTimeToFirstIcon = 0.f;
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	float MaxTimeToFirstIcon = 0.f;
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	float AverageTimeToFinal = 0.f;
+	UPROPERTY(BlueprintReadOnly, Category = "Thumbnail")
+	float MaxTimeToFinal = 0.f;
+};
+
+// Points a request passes on its way through the pipeline, in the order they happen.
+enum class EThumbnailStage : uint8
+{
+	Queued,
+	// First picked up by DoInitState, everything before is spent waiting in the queue.
+	Init,
+	// Parked behind a larger render of the same mesh, or served from the cache or a cached larger size.
+	Coalesced,
+	// Mesh, materials and lighting set up in the preview scene.
+	Loaded,
+	// Last settle capture submitted.
+	Settled,
+	// GPU done with the capture and its readback copy.
+	Captured,
+	// Pixels converted and post processed on a worker, back on the game thread for textures.
+	ReadBack,
+	Delivered,
+	Num
+};
+
+enum class EThumbnailResultSource : uint8
+{
+	Rendered,
+	Cache,
+	Downsampled
+};
+
+/** Timestamps of one request, kept in a ring buffer once delivered so slow icons can be explained after the fact. */
+struct THUMBNAILPLUGIN_API FThumbnailTimeline
+{
+	// FPlatformTime::Seconds, zero for stages the request skipped.
+	double Stamps[(int32)EThumbnailStage::Num] = {};
+	FName Asset;
+	FName AssetType;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	EThumbnailOutputMode OutputMode = EThumbnailOutputMode::Texture2D;
+	EThumbnailResultSource Source = EThumbnailResultSource::Rendered;
+
+	void Stamp(EThumbnailStage stage, double time = FPlatformTime::Seconds()) { Stamps[(int32)stage] = time; };
+	double Get(EThumbnailStage stage) const { return Stamps[(int32)stage]; };
+	// Seconds since the latest earlier stage that was stamped. Negative when stage was skipped.
+	double GetDuration(EThumbnailStage stage) const;
+	double GetTotal() const { return Get(EThumbnailStage::Delivered) - Get(EThumbnailStage::Queued); };
+};
+
+/** One mesh of a composite thumbnail, such as a body, an armor piece or a socketed weapon. */
+USTRUCT(BlueprintType)
+struct THUMBNAILPLUGIN_API FThumbnailPart
+{
+	GENERATED_BODY()
+
+	// Set one of the two meshes.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	TObjectPtr<UStaticMesh> StaticMesh = nullptr;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	TObjectPtr<USkeletalMesh> SkeletalMesh = nullptr;
+
+	// Index of an earlier part to attach to. INDEX_NONE places the part at the origin.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	int32 Parent = INDEX_NONE;
+	// Socket or bone on the parent.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	FName Socket = NAME_None;
+	// Skeletal parts on a skeletal parent only. Follows the parent's pose instead of attaching to a socket.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	bool bUseLeaderPose = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	FTransform RelativeTransform = FTransform::Identity;
+
+	// Identifies the composite in the cache key.
+	static uint32 GetHash(const TArray<FThumbnailPart>& parts);
+};
+
+/** Swaps or parameterizes one material slot of the previewed mesh. Parameters are applied through a dynamic instance. */
+USTRUCT(BlueprintType)
+struct THUMBNAILPLUGIN_API FThumbnailMaterialOverride
+{
+	GENERATED_BODY()
+
+	// Composite requests only, index of the part to override.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	int32 Part = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	int32 Slot = 0;
+	// Takes precedence over Slot when set.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	FName SlotName = NAME_None;
+
+	// Null keeps the mesh's own material and only applies the parameters.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	TObjectPtr<UMaterialInterface> Material = nullptr;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	TMap<FName, float> ScalarParameters;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	TMap<FName, FLinearColor> VectorParameters;
+
+	// Zero for an empty list. Parameter order does not matter.
+	static uint32 GetHash(const TArray<FThumbnailMaterialOverride>& overrides);
+};
+
+/**
+ * CPU passes run over the read back pixels on worker threads, before the texture is built or the pixels are delivered.
+ * Texture2D and Pixels output only, render targets never leave the GPU.
+ */
+USTRUCT(BlueprintType)
+struct THUMBNAILPLUGIN_API FThumbnailPostProcess
+{
+	GENERATED_BODY()
+
+	// Color multiplied by alpha, for UI that blends premultiplied images.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	bool bPremultiplyAlpha = false;
+
+	// Crops transparent rows and columns, so the result is smaller than requested. Background fill is ignored for this.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	bool bTrimTransparentBorder = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	int32 TrimPadding = 2;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	bool bFillBackground = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	FLinearColor BackgroundColor = FLinearColor::Black;
+
+	// In pixels, 0 disables the outline.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	int32 OutlineWidth = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	FLinearColor OutlineColor = FLinearColor::Black;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	bool bDropShadow = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	FIntPoint ShadowOffset = FIntPoint(4, 4);
+	// Box blur radius in pixels.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	int32 ShadowBlur = 4;
+	// Alpha is the shadow's opacity.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thumbnail")
+	FLinearColor ShadowColor = FLinearColor(0.f, 0.f, 0.f, 0.5f);
+
+	bool IsActive() const { return bPremultiplyAlpha || bTrimTransparentBorder || bFillBackground || OutlineWidth > 0 || bDropShadow; };
+	// Zero when no pass is enabled.
+	uint32 GetHash() const;
+};
+
+/** Refers to a pooled request. Goes stale, rather than pointing at someone else's request, once the slot is reused. */
+struct FThumbnailRequestHandle
+{
+	int32 Index = INDEX_NONE;
+	uint32 Generation = 0;
+
+	bool IsValid() const { return Index != INDEX_NONE; };
+	bool operator==(const FThumbnailRequestHandle& other) const { return Index == other.Index && Generation == other.Generation; };
+};
+
+struct THUMBNAILPLUGIN_API FThumbnailRequest
+{
+	TObjectPtr<UStaticMesh> StaticMesh = nullptr;
+	TObjectPtr<USkeletalMesh> SkeletalMesh = nullptr;
+	TObjectPtr<UGeometryCollection> GeometryCollection = nullptr;
+	// Rendered together in one capture instead of the single mesh above.
+	TArray<FThumbnailPart> Parts;
+	// A request that only differs from the previous one by these skips reframing and relighting.
+	TArray<FThumbnailMaterialOverride> MaterialOverrides;
+	// Falls back to the subsystem's default preset when null.
+	TObjectPtr<UThumbnailLightingPreset> LightingPreset = nullptr;
+
+	int SizeX = 256;
+	int SizeY = 256;
+
+	int32 ProcessingCount = 5;
+
+	EThumbnailOutputMode OutputMode = EThumbnailOutputMode::Texture2D;
+	EThumbnailQualityProfile QualityProfile = EThumbnailQualityProfile::Standard;
+	EThumbnailCallbackThread CallbackThread = EThumbnailCallbackThread::Default;
+
+	// Higher priorities are rendered first. Equal priorities go newest first.
+	int32 Priority = 0;
+	// Texture2D only. Delivers a tiny unlit placeholder through OnComplete first, then the full render through the same delegate.
+	bool bProgressive = false;
+
+	TDelegate<void(UTexture2D*)> OnComplete;
+	// Fired alongside OnComplete in Texture2D mode. Holding the handle keeps the texture from being evicted.
+	TDelegate<void(const FThumbnailHandle&)> OnHandleComplete;
+	TDelegate<void(UTextureRenderTarget2D*)> OnRenderTargetComplete;
+
+	// Used when OutputMode is Pixels.
+	FThumbnailPixelRequest PixelRequest;
+	FOnThumbnailPixels OnPixelsComplete;
+
+	FThumbnailPostProcess PostProcess;
+
+	EJPBThumbnailRenderState State = EJPBThumbnailRenderState::ThumbnailRenderState_Init;
+
+	// Game instance subsystem that queued the request, if any.
+	FObjectKey Owner;
+
+	FThumbnailRequestHandle Handle;
+	bool bInUse = false;
+	bool bPlaceholderQueued = false;
+	bool bPlaceholderDelivered = false;
+	double QueuedTime = 0.0;
+	FThumbnailTimeline Timeline;
+
+	// Packages the render is made from, gathered when the capture starts and stored with the cached result.
+	TArray<FThumbnailDependency> Dependencies;
+	// One of Dependencies changed while the render was in flight. The result is thrown away and the request rendered again.
+	bool bDependencyChanged = false;
+
+	UObject* GetAsset() const;
+	FThumbnailCacheKey GetCacheKey() const;
+	void GatherDependencies();
+	bool DependsOn(FName packageName) const;
+};
+
+/**
+ * A request built off the game thread. Handed to UThumbnailSubsystem::SubmitThumbnail, which may be called from any thread.
+ * The strong pointers keep the assets alive until the submission is picked up by the subsystem.
+ */
+struct THUMBNAILPLUGIN_API FThumbnailSubmission
+{
+	// UStaticMesh, USkeletalMesh or UGeometryCollection.
+	TStrongObjectPtr<UObject> Asset;
+	// Rendered together in one capture instead of Asset when not empty.
+	TArray<FThumbnailPart> Parts;
+	TArray<FThumbnailMaterialOverride> MaterialOverrides;
+	// Meshes and materials named by Parts and MaterialOverrides, held by SubmitThumbnail until the tick picks the submission up.
+	TArray<TStrongObjectPtr<UObject>> ReferencedObjects;
+	// Falls back to the subsystem's default preset when null.
+	TStrongObjectPtr<UThumbnailLightingPreset> LightingPreset;
+
+	int32 SizeX = 256;
+	int32 SizeY = 256;
+	EThumbnailOutputMode OutputMode = EThumbnailOutputMode::Texture2D;
+	EThumbnailQualityProfile QualityProfile = EThumbnailQualityProfile::Standard;
+	EThumbnailCallbackThread CallbackThread = EThumbnailCallbackThread::Default;
+	int32 Priority = 0;
+	bool bProgressive = false;
+
+	TDelegate<void(UTexture2D*)> OnComplete;
+	TDelegate<void(const FThumbnailHandle&)> OnHandleComplete;
+	TDelegate<void(UTextureRenderTarget2D*)> OnRenderTargetComplete;
+	FThumbnailPixelRequest PixelRequest;
+	FOnThumbnailPixels OnPixelsComplete;
+	FThumbnailPostProcess PostProcess;
+
+	// Submissions whose owner has been cancelled or destroyed by the time they are picked up are dropped without calling back.
+	FObjectKey Owner;
+	// Set by SubmitThumbnail, the request's latency counts from here rather than from when the tick picked it up.
+	double SubmittedTime = 0.0;
+};
+
+/**
+ * Recycled storage for requests. Records live behind stable pointers and are reset rather than freed,
+ * so queuing thousands of thumbnails creates no UObjects and nothing for GC to sweep afterwards.
+ * Assets referenced by live requests are kept alive through FGCObject.
+ */
+class THUMBNAILPLUGIN_API FThumbnailRequestPool : public FGCObject
+{
+public:
+	FThumbnailRequest* Allocate();
+	void Free(FThumbnailRequest* request);
+	// Null when the handle is stale.
+	FThumbnailRequest* Get(const FThumbnailRequestHandle& handle) const;
+
+	int32 GetNumInUse() const { return Requests.Num() - FreeIndices.Num(); };
+
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
+
+private:
+	TArray<TUniquePtr<FThumbnailRequest>> Requests;
+	TArray<int32> FreeIndices;
+};
@@ -4,6 +4,7 @@
 #include "UObject/GCObject.h"
 #include "Engine/World.h"
 #include "SceneView.h"
+#include "ThumbnailQuality.h"
 
 class UDirectionalLightComponent;
 class USkyLightComponent;
@@ -11,6 +12,9 @@ class USkyAtmosphereComponent;
 class ARenderActor;
 class AThumbnailPreviewMeshActor;
 class UGeometryCollection;
+class UThumbnailLightingPreset;
+struct FThumbnailPart;
+struct FThumbnailMaterialOverride;
 
 class THUMBNAILPLUGIN_API FThumbnailScene : public FGCObject
 {
@@ -52,7 +56,7 @@ public:
 	bool IsRenderDirty() const { return RenderDirty > 0; };
 
 	void SetRenderDirty(uint8 numFrames = 2) { RenderDirty = numFrames > RenderDirty ? numFrames : RenderDirty; };
-	void SetLightingDirty(uint8 numFrames = 2) { LightingDirty = numFrames > LightingDirty ? numFrames : LightingDirty; };
+	void SetLightingDirty(uint8 numFrames = 2);
 	void DeprojectScreenToWorld(const FVector2D& ScreenPosition, FVector& WorldPosition, FVector& WorldDirection);
 	void ProjectWorldToScreen(const FVector& WorldPosition, FVector2D& ScreenPosition);
 	void SetRenderTarget(UTextureRenderTarget2D* target);
@@ -64,12 +68,26 @@ public:
 	void SetStaticMesh(UStaticMesh* mesh);
 	void SetSkeletalMesh(USkeletalMesh* mesh);
 	void SetGeometryCollection(UGeometryCollection* collection);
+	// Several meshes framed together and captured in one render.
+	void SetComposite(const TArray<FThumbnailPart>& parts);
+	// Only marks the render dirty, framing and lighting are left alone.
+	void SetMaterialOverrides(const TArray<FThumbnailMaterialOverride>& overrides);
+	void SetQualityProfile(EThumbnailQualityProfile profile);
+	// Null returns to the live sky atmosphere capture.
+	void SetLightingPreset(UThumbnailLightingPreset* preset);
+	UThumbnailLightingPreset* GetLightingPreset() const { return LightingPreset; };
+	// Forgets the previewed mesh and the preset sky lights, so assets edited since are framed and lit afresh on their next use.
+	void ReleasePreviewAssets();
 
 protected:
 
 	virtual void InitScene();
 
 private:
+	void ApplyLightingPreset();
+	// Sky atmosphere and real time sky light, never created for scenes that only render with presets.
+	void CreateLiveSky();
+	void FrameMeshActor();
 	void UpdateViewMatrix();
 	void Uninitialize();
 public:
@@ -91,4 +109,8 @@ private:
 	TObjectPtr<UDirectionalLightComponent> DirectionalLight = nullptr;
 	TObjectPtr<USkyAtmosphereComponent> SkyAtmosphere = nullptr;
 	TObjectPtr<USkyLightComponent> SkyLight = nullptr;
+
+	TObjectPtr<UThumbnailLightingPreset> LightingPreset = nullptr;
+	// One cubemap sky light per preset used so far. Only the active one is visible.
+	TMap<TObjectPtr<UThumbnailLightingPreset>, TObjectPtr<USkyLightComponent>> PresetSkyLights;
 };
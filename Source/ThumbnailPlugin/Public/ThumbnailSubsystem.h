@@ -4,85 +4,75 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
-#include "Containers/Ticker.h"
+#include <atomic>
+#include "ThumbnailCache.h"
+#include "ThumbnailRequest.h"
 #include "ThumbnailSubsystem.generated.h"
 
-class FThumbnailScene;
 class UStaticMesh;
 class USkeletalMesh;
 class UTextureRenderTarget2D;
 class UGeometryCollection;
+class UThumbnailLightingPreset;
+class UThumbnailEngineSubsystem;
 
-enum EJPBThumbnailRenderState
-{
-	ThumbnailRenderState_Init,
-	ThumbnailRenderState_Processing,
-	ThumbnailRenderState_Completed
-};
-
+/**
+ * Per game instance handle to the shared UThumbnailEngineSubsystem. Requests queued through it are tagged
+ * with this game instance and dropped when it shuts down, everything else is shared.
+ */
 UCLASS()
-class UThumbnailQueuedEntry : public UObject
+class THUMBNAILPLUGIN_API UThumbnailSubsystem : public UGameInstanceSubsystem
 {
 	GENERATED_BODY()
 
-public:
-
-	UPROPERTY()
-	UStaticMesh* StaticMesh = nullptr;
 	UPROPERTY()
-	USkeletalMesh* SkeletalMesh = nullptr;
-	UPROPERTY()
-	UGeometryCollection* GeometryCollection;
-
-	int SizeX = 256;
-	int SizeY = 256;
-	bool bProcessingCompleted = false;
-	bool bComplete = false;
-
-	int32 ProcessingCount = 5;
-
-	TDelegate<void(UTexture2D*)> OnComplete;
+	TObjectPtr<UThumbnailEngineSubsystem> Service = nullptr;
+	// Same as Service for SubmitThumbnail, which may run on any thread. The engine subsystem outlives every game instance.
+	std::atomic<UThumbnailEngineSubsystem*> SubmitService = nullptr;
 
-	EJPBThumbnailRenderState State = EJPBThumbnailRenderState::ThumbnailRenderState_Init;
-};
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
 
-UCLASS()
-class THUMBNAILPLUGIN_API UThumbnailSubsystem : public UGameInstanceSubsystem
-{
-	GENERATED_BODY()
+	// The returned request is owned by the engine subsystem. Configure it straight away, it is recycled once completed.
+	FThumbnailRequest* QueueMeshThumbnail(UStaticMesh* mesh);
+	FThumbnailRequest* QueueMeshThumbnail(USkeletalMesh* mesh);
+	FThumbnailRequest* QueueMeshThumbnail(UGeometryCollection* collection);
+	FThumbnailRequest* QueueMeshThumbnail(const TArray<FThumbnailPart>& parts);
+	// Thread safe. The request is picked up on the next tick, the subsystem must outlive the call.
+	// Nothing is called back once this subsystem deinitializes, do not block a worker on the result.
+	void SubmitThumbnail(FThumbnailSubmission&& submission);
+	// Game thread. Drops a request queued above, see UThumbnailEngineSubsystem::CancelRequest.
+	void CancelRequest(const FThumbnailRequestHandle& handle);
 
-	FThumbnailScene* PreviewScene = nullptr;
+	// Returns a render target delivered in RenderTarget output mode to the pool.
+	UFUNCTION(BlueprintCallable, Category = "Thumbnail")
+	void ReleaseRenderTarget(UTextureRenderTarget2D* renderTarget);
 
-	UPROPERTY()
-	TObjectPtr<UThumbnailQueuedEntry> CurrentEntry = nullptr;
-	UPROPERTY()
-	TArray<TObjectPtr<UThumbnailQueuedEntry>> Queue;
-	UPROPERTY()
-	TObjectPtr<UTextureRenderTarget2D> RenderTarget = nullptr;
-	FVector2D RenderTargetSize = FVector2D(128, 128);
+	// Pins a texture delivered by this subsystem so it is not evicted while the handle is alive.
+	UFUNCTION(BlueprintCallable, Category = "Thumbnail")
+	FThumbnailHandle PinThumbnail(UTexture2D* texture);
 
-	FTickerDelegate					TickDelegate;
+	// Covers every game instance, the cache and pools are shared.
+	UFUNCTION(BlueprintCallable, Category = "Thumbnail")
+	FThumbnailMemoryStats GetMemoryStats() const;
 
-	FTSTicker::FDelegateHandle		TickDelegateHandle;
+	// Lighting used by requests that do not name a preset. Null uses the live sky atmosphere rig. Shared by all game instances.
+	UFUNCTION(BlueprintCallable, Category = "Thumbnail")
+	void SetDefaultLightingPreset(UThumbnailLightingPreset* preset);
 
-public:
-	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
-	virtual void Deinitialize() override;
+	UFUNCTION(BlueprintCallable, Category = "Thumbnail")
+	FThumbnailLatencyStats GetLatencyStats() const;
 
-	UThumbnailQueuedEntry* QueueMeshThumbnail(UStaticMesh* mesh);
-	UThumbnailQueuedEntry* QueueMeshThumbnail(USkeletalMesh* mesh);
-	UThumbnailQueuedEntry* QueueMeshThumbnail(UGeometryCollection* collection);
-	bool ThumbnailTick(float DeltaTime);
+	// Drops every thumbnail that is not pinned by a handle and every pooled render target not handed out.
+	UFUNCTION(BlueprintCallable, Category = "Thumbnail")
+	void TrimUnreferencedThumbnails();
 
+	// Distinct assets whose cached thumbnails are identical or nearly so, e.g. placeholder art or unset materials.
+	UFUNCTION(BlueprintCallable, Category = "Thumbnail")
+	TArray<FThumbnailDuplicateGroup> GetDuplicateGroups() const;
 
 private:
-	UThumbnailQueuedEntry* QueueThumbnail();
-	void DoInitState();
-	void DoProcessingState();
-	void DoCompletedState();
-
-	void EndThumbnailProcessing();
-	void StartThumbnailProcessing();
+	template <typename TSubject>
+	FThumbnailRequest* QueueOwnedThumbnail(const TSubject& subject);
 };
-
-
@@ -37,6 +37,8 @@ public class ThumbnailPlugin : ModuleRules
 				"CoreUObject",
 				"Engine",
 				"GeometryCollectionEngine",
+				"ImageWrapper",
+				"Projects",
 				"RHI",
 				"RenderCore"
 				// ... add private dependencies that you statically link with here ...	